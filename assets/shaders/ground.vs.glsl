@@ -9,6 +9,9 @@ out vec2 fragTexCoord;
 out vec4 fragColor;
 
 uniform mat4 mvp;
+uniform mat4 matModel;
+// world size of one repeat of the ground texture
+uniform float tile;
 
 vec3 fix(vec4 v)
 {
@@ -17,7 +20,7 @@ vec3 fix(vec4 v)
 
 void main()
 {
-	fragTexCoord = vertexTexCoord;
+	fragTexCoord = (matModel * vec4(vertexPosition, 1.0)).xz / tile;
 	fragColor = vertexColor;
 	gl_Position = mvp * vec4(vertexPosition, 1.0);
 }
@@ -0,0 +1,313 @@
+#include "game.hpp"
+
+// C++
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+
+// bench [--filter text] [--out results.json] [--compare baseline.json]
+//       [--threshold 0.1] [--min-time 0.2]
+//
+// Each benchmark is run enough times to last min-time seconds, 5 times, and
+// the median time per op is kept. With --compare, any benchmark slower than
+// the baseline by more than threshold (relative) makes the exit code 1.
+
+namespace {
+
+struct Bench {
+  std::string name{};
+  std::function<void()> op{};
+  std::function<void()> setup{};
+};
+
+struct Result {
+  std::string name{};
+  double nsPerOp{};
+  int64_t iterations{};
+};
+
+volatile float sink{};
+
+double Seconds(std::chrono::steady_clock::time_point t0) {
+  const std::chrono::duration<double> d = std::chrono::steady_clock::now() - t0;
+  return d.count();
+}
+
+Result Run(const Bench &b, double minTime) {
+  if (b.setup)
+    b.setup();
+  int64_t iterations = 1;
+  for (;;) {
+    const auto t0 = std::chrono::steady_clock::now();
+    for (int64_t i = 0; i < iterations; ++i)
+      b.op();
+    const double t = Seconds(t0);
+    if (t >= minTime)
+      break;
+    iterations *= t > 0.0 ? std::clamp(minTime / t * 1.2, 1.5, 100.0) : 100.0;
+  }
+  std::array<double, 5> samples{};
+  for (double &s : samples) {
+    const auto t0 = std::chrono::steady_clock::now();
+    for (int64_t i = 0; i < iterations; ++i)
+      b.op();
+    s = Seconds(t0) * 1e9 / iterations;
+  }
+  std::sort(samples.begin(), samples.end());
+  return {b.name, samples[samples.size() / 2], iterations};
+}
+
+void WriteJson(FILE *f, const std::vector<Result> &results) {
+  fprintf(f, "{\n  \"benchmarks\": [\n");
+  for (size_t i = 0; i < results.size(); ++i) {
+    const Result &r = results[i];
+    fprintf(f,
+            "    {\"name\": \"%s\", \"ns_per_op\": %.3f, "
+            "\"iterations\": %lld}%s\n",
+            r.name.c_str(), r.nsPerOp, (long long)r.iterations,
+            i + 1 < results.size() ? "," : "");
+  }
+  fprintf(f, "  ]\n}\n");
+}
+
+// reads back what WriteJson writes, not a general JSON parser
+std::map<std::string, double> ReadJson(const char *path) {
+  std::map<std::string, double> r;
+  char *text = LoadFileText(path);
+  if (text == nullptr)
+    return r;
+  const char *p = text;
+  while ((p = strstr(p, "\"name\": \"")) != nullptr) {
+    p += strlen("\"name\": \"");
+    const char *end = strchr(p, '"');
+    const char *ns = end ? strstr(end, "\"ns_per_op\": ") : nullptr;
+    if (ns == nullptr)
+      break;
+    r[std::string(p, end)] = atof(ns + strlen("\"ns_per_op\": "));
+    p = ns;
+  }
+  UnloadFileText(text);
+  return r;
+}
+
+std::vector<Car> MakeCars(const Track &track, size_t count) {
+  std::vector<Car> cars(count);
+  Rng rng = MakeRng(1234);
+  for (Car &car : cars) {
+    const float s = rng.Range(0, 1000) * track.space.length / 1000.0f;
+    const auto [p, n] = SampleTrack(track.space, s);
+    car.data.pos = p;
+    car.data.dir = atan2f(-n.x, n.y);
+    car.data.speed = 20.0f * Vector2{cosf(car.data.dir), sinf(car.data.dir)};
+    car.data.thrust = rng.Range(0, 100);
+    car.inputs = {
+        .cwheel = rng.Range(-127, 127) / 127.0f,
+        .cthrust = float(rng.Range(0, 1)),
+        .brake = float(rng.Range(0, 3) == 0),
+    };
+    car.trackPos = ProjectOnTrack(track.space, p);
+  }
+  return cars;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  SetTraceLogLevel(LOG_WARNING);
+  const char *filter = GetArg(argc, argv, "--filter").value_or("");
+  const auto outPath = GetArg(argc, argv, "--out");
+  const auto comparePath = GetArg(argc, argv, "--compare");
+  const double threshold =
+      atof(GetArg(argc, argv, "--threshold").value_or("0.1"));
+  const double minTime = atof(GetArg(argc, argv, "--min-time").value_or("0.2"));
+
+  const std::vector<Vector2> points = MakeRandomTrack(1);
+  const Track track = MakeTrack(points, nullptr);
+
+  std::vector<Bench> benches;
+
+  for (size_t count : {1, 10, 100, 1000, 10000}) {
+    auto cars = std::make_shared<std::vector<Car>>(MakeCars(track, count));
+    auto batch = std::make_shared<CarBatch>();
+    benches.push_back({
+        "UpdateCar/" + std::to_string(count),
+        [cars]() {
+          for (Car &car : *cars)
+            UpdateCar(car.inputs, car.data, 1.0f, 1.0f);
+          sink = (*cars)[0].data.pos.x;
+        },
+        [cars, &track, count]() { *cars = MakeCars(track, count); },
+    });
+    benches.push_back({
+        "UpdateCars/" + std::to_string(count),
+        [batch, count]() {
+          UpdateCars(*batch, count, 1.0f);
+          sink = batch->posX[0];
+        },
+        [cars, batch, count]() {
+          ResizeCarBatch(*batch, count);
+          for (size_t i = 0; i < count; ++i) {
+            const Car &car = (*cars)[i];
+            batch->posX[i] = car.data.pos.x;
+            batch->posY[i] = car.data.pos.y;
+            batch->speedX[i] = car.data.speed.x;
+            batch->speedY[i] = car.data.speed.y;
+            batch->thrust[i] = car.data.thrust;
+            batch->dir[i] = car.data.dir;
+            batch->cwheel[i] = car.inputs.cwheel;
+            batch->cthrust[i] = car.inputs.cthrust;
+            batch->brake[i] = car.inputs.brake;
+            batch->grip[i] = 1.0f;
+          }
+        },
+    });
+  }
+
+  // one car driving the center line, one step per op
+  auto sim = std::make_shared<SimState>(SimState{.track = &track});
+  auto step = std::make_shared<float>();
+  benches.push_back({
+      "UpdateCheckPoint",
+      [sim, step, &track]() {
+        const float s0 = *step;
+        *step = fmodf(s0 + 0.7f, track.space.length);
+        UpdateCheckPoint(*sim, sim->cars[0],
+                         SampleTrack(track.space, s0).first,
+                         SampleTrack(track.space, *step).first);
+      },
+      [sim, step, &track]() {
+        *step = track.space.length - 1.0f;
+        sim->players = {};
+        sim->players[0].enabled = true;
+        sim->cars = {Car{.playerIndex = 0}};
+      },
+  });
+
+  // 4 players and 100 bots, what a rollback costs besides the ticks
+  auto netSim = std::make_shared<SimState>(SimState{.track = &track});
+  auto snapshot = std::make_shared<SimSnapshot>();
+  const auto netSetup = [netSim, snapshot]() {
+    for (int i = 0; i < 4; ++i)
+      netSim->players[i].enabled = true;
+    InitCars(*netSim, 100);
+    SaveSnapshot(*netSim, *snapshot);
+  };
+  benches.push_back({
+      "SaveSnapshot",
+      [netSim, snapshot]() { SaveSnapshot(*netSim, *snapshot); },
+      netSetup,
+  });
+  benches.push_back({
+      "RestoreSnapshot",
+      [netSim, snapshot]() { RestoreSnapshot(*netSim, *snapshot); },
+      netSetup,
+  });
+
+  // steady state, 4 particles per car per tick for 4 sliding cars
+  auto particles = std::make_shared<Particles>();
+  auto gtime = std::make_shared<double>();
+  benches.push_back({
+      "Particles",
+      [particles, gtime]() {
+        *gtime += 1 / 60.0;
+        UpdateParticles(*particles, *gtime, 1.0f / BaseTickRate);
+        for (int i = 0; i < 16; ++i)
+          SpawnParticle(*particles, {float(i), 0}, {1, 1}, *gtime, 0.5f);
+      },
+      [particles, gtime]() {
+        *particles = {};
+        *gtime = 0.0;
+      },
+  });
+
+  auto seed = std::make_shared<uint32_t>();
+  benches.push_back({
+      "MakeTrack",
+      [seed]() {
+        const Track t = MakeTrack(MakeRandomTrack(++*seed), nullptr);
+        sink = t.space.length;
+      },
+  });
+  benches.push_back({
+      "CatmullRom/1000",
+      [&points]() {
+        float sum = 0.0f;
+        for (int i = 0; i < 1000; ++i)
+          sum += GetSplineAndDir(points, i / 1000.0f).first.x;
+        sink = sum;
+      },
+  });
+  benches.push_back({
+      "MakeTrackRoad",
+      [&track]() {
+        const auto road =
+            MakeTrackRoad(track.space, {-RoadHalfWidth, RoadHalfWidth},
+                          150.0f);
+        sink = road.size();
+      },
+  });
+
+  benches.push_back({
+      "MakeSurfaceGrid",
+      [&track]() {
+        const SurfaceGrid grid =
+            MakeSurfaceGrid(track.space, RoadHalfWidth, track.aabb);
+        sink = grid.dist.size();
+      },
+  });
+  // lookups spread over the track, half of them off the road
+  auto probes = std::make_shared<std::vector<Vector2>>();
+  for (int i = 0; i < 1000; ++i) {
+    const auto [p, n] = SampleTrack(track.space, i * track.space.length / 1000);
+    probes->push_back(p + (i % 2 ? 10.0f : 40.0f) * n);
+  }
+  benches.push_back({
+      "SurfaceGrip/1000",
+      [probes, &track]() {
+        float sum = 0.0f;
+        for (const Vector2 p : *probes)
+          sum += SurfaceGrip(track.surface, p);
+        sink = sum;
+      },
+  });
+
+  std::vector<Result> results;
+  for (const Bench &b : benches) {
+    if (!strstr(b.name.c_str(), filter))
+      continue;
+    results.push_back(Run(b, minTime));
+    printf("%-20s %14.1f ns/op %12lld iterations\n", b.name.c_str(),
+           results.back().nsPerOp, (long long)results.back().iterations);
+  }
+
+  if (outPath) {
+    FILE *f = fopen(*outPath, "w");
+    if (f == nullptr) {
+      fprintf(stderr, "can't write %s\n", *outPath);
+      return 1;
+    }
+    WriteJson(f, results);
+    fclose(f);
+  }
+
+  int regressions = 0;
+  if (comparePath) {
+    const auto baseline = ReadJson(*comparePath);
+    printf("\ncompared to %s (threshold %+.0f%%)\n", *comparePath,
+           100.0 * threshold);
+    for (const Result &r : results) {
+      const auto it = baseline.find(r.name);
+      if (it == baseline.end() || it->second <= 0.0) {
+        printf("%-20s %14s\n", r.name.c_str(), "new");
+        continue;
+      }
+      const double change = r.nsPerOp / it->second - 1.0;
+      const bool slower = change > threshold;
+      regressions += slower;
+      printf("%-20s %+13.1f%%%s\n", r.name.c_str(), 100.0 * change,
+             slower ? "  REGRESSION" : "");
+    }
+  }
+  return regressions > 0 ? 1 : 0;
+}
@@ -0,0 +1,108 @@
+#include "game.hpp"
+
+// The racing line is the center line pulled tight within the road: each
+// sample moves toward the middle of its neighbors, clamped to the road
+// width, which shortens the line and cuts corners at their apex. Target
+// speeds come from its curvature, the car turning at a bounded yaw rate,
+// then are lowered so the car can brake in time for the next corner.
+
+namespace {
+
+constexpr float LineStep = 8.0f;
+constexpr float LineMargin = 8.0f;
+constexpr int LineIterations = 400;
+// top speed and turn radius per unit of speed of the cars, with margins
+constexpr float TopSpeed = 48.0f;
+constexpr float TurnRadius = 3.5f;
+// speed^2 lost per unit of distance when braking, half the car's
+constexpr float BrakeRate = 4.0f;
+
+float WrapAngle(float a) { return atan2f(sinf(a), cosf(a)); }
+
+} // namespace
+
+RacingLine MakeRacingLine(const TrackSpace &ts, float halfWidth) {
+  RacingLine line;
+  const int count = std::max(8, int(ts.length / LineStep + 0.5f));
+  line.step = ts.length / count;
+  const float width = std::max(0.0f, halfWidth - LineMargin);
+
+  std::vector<Vector2> center(count);
+  std::vector<Vector2> normal(count);
+  for (int i = 0; i < count; ++i)
+    std::tie(center[i], normal[i]) = SampleTrack(ts, i * line.step);
+
+  line.pos = center;
+  for (int it = 0; it < LineIterations; ++it) {
+    for (int i = 0; i < count; ++i) {
+      const Vector2 prev = line.pos[(i + count - 1) % count];
+      const Vector2 next = line.pos[(i + 1) % count];
+      const Vector2 mid = 0.5f * (prev + next);
+      const float o = Vector2DotProduct(mid - center[i], normal[i]);
+      line.pos[i] = center[i] + Clamp(o, -width, width) * normal[i];
+    }
+  }
+
+  line.speed.resize(count);
+  for (int i = 0; i < count; ++i) {
+    const Vector2 a = line.pos[(i + count - 1) % count];
+    const Vector2 b = line.pos[i];
+    const Vector2 c = line.pos[(i + 1) % count];
+    const Vector2 u = b - a;
+    const Vector2 v = c - b;
+    const float turn =
+        abs(atan2f(u.x * v.y - u.y * v.x, Vector2DotProduct(u, v)));
+    const float curvature = turn / Vector2Distance(a, c) * 2.0f;
+    line.speed[i] =
+        std::min(TopSpeed, 1.0f / (TurnRadius * std::max(curvature, 1e-6f)));
+  }
+  // braking distance, twice around so it carries over the start
+  for (int k = 2 * count - 1; k > 0; --k) {
+    const int i = (k - 1) % count;
+    const int j = k % count;
+    const float ds = Vector2Distance(line.pos[i], line.pos[j]);
+    line.speed[i] =
+        std::min(line.speed[i],
+                 sqrtf(line.speed[j] * line.speed[j] + BrakeRate * ds));
+  }
+  return line;
+}
+
+// aims at a point of the racing line ahead, further with speed, and keeps
+// under the target speed of the line around the car
+CarInputs DriveCar(const RacingLine &line, const Car &car) {
+  const int count = line.pos.size();
+  const Vector2 pos = car.data.pos;
+  const Vector2 vel = car.data.speed;
+  const float speed = Vector2Length(vel);
+
+  const float u = car.trackPos.s / line.step;
+  const int i0 = int(u) % count;
+  const float ahead = 12.0f + 0.6f * speed;
+  const float ua = u + ahead / line.step;
+  const int a0 = int(ua) % count;
+  const Vector2 target = Vector2Lerp(line.pos[a0], line.pos[(a0 + 1) % count],
+                                     ua - floorf(ua));
+  const float targetSpeed = std::min(line.speed[i0], line.speed[a0]);
+
+  const Vector2 to = target - pos;
+  const float ta = atan2f(to.y, to.x);
+  const float va = speed > 1.0f ? atan2f(vel.y, vel.x) : car.data.dir;
+  const float da =
+      WrapAngle(ta + Clamp(WrapAngle(ta - va), -0.5f, 0.5f) - car.data.dir);
+  return {
+      .cwheel = Clamp(4.0f * da, -1.0f, 1.0f),
+      .cthrust = speed < targetSpeed ? 1.0f : 0.0f,
+      .brake = speed > targetSpeed + 2.0f ? 1.0f : 0.0f,
+  };
+}
+
+// fills the inputs of the cars no player drives
+void DriveBots(const SimState &sim, std::span<CarInputs> inputs) {
+  const RacingLine &line = sim.track->line;
+  for (size_t i = 0; i < sim.cars.size(); ++i) {
+    const Car &car = sim.cars[i];
+    if (!car.playerIndex)
+      inputs[i] = QuantizeInputs(DriveCar(line, car));
+  }
+}
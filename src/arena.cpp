@@ -0,0 +1,136 @@
+#include "game.hpp"
+
+// C++
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+constexpr size_t MinArenaSize = 64 * 1024;
+
+#ifdef DEBUG
+std::atomic<int64_t> heapAllocations{};
+#endif
+
+} // namespace
+
+#ifdef DEBUG
+// Every form of operator new is counted, on any thread, and all of them
+// share one aligned allocation so that any delete can free any of them.
+// malloc from C code is not seen.
+
+namespace {
+
+void *CountedAlloc(size_t size, size_t align) noexcept {
+  heapAllocations.fetch_add(1, std::memory_order_relaxed);
+  size = std::max<size_t>(size, 1);
+  align = std::max(align, sizeof(void *));
+#ifdef _WIN32
+  return _aligned_malloc(size, align);
+#else
+  void *p = nullptr;
+  return posix_memalign(&p, align, size) == 0 ? p : nullptr;
+#endif
+}
+
+void CountedFree(void *p) noexcept {
+#ifdef _WIN32
+  _aligned_free(p);
+#else
+  free(p);
+#endif
+}
+
+void *CountedNew(size_t size, size_t align) {
+  if (void *p = CountedAlloc(size, align))
+    return p;
+  throw std::bad_alloc();
+}
+
+constexpr size_t DefaultAlign = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+} // namespace
+
+void *operator new(size_t size) { return CountedNew(size, DefaultAlign); }
+void *operator new[](size_t size) { return CountedNew(size, DefaultAlign); }
+void *operator new(size_t size, std::align_val_t align) {
+  return CountedNew(size, size_t(align));
+}
+void *operator new[](size_t size, std::align_val_t align) {
+  return CountedNew(size, size_t(align));
+}
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+  return CountedAlloc(size, DefaultAlign);
+}
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+  return CountedAlloc(size, DefaultAlign);
+}
+void *operator new(size_t size, std::align_val_t align,
+                   const std::nothrow_t &) noexcept {
+  return CountedAlloc(size, size_t(align));
+}
+void *operator new[](size_t size, std::align_val_t align,
+                     const std::nothrow_t &) noexcept {
+  return CountedAlloc(size, size_t(align));
+}
+
+void operator delete(void *p) noexcept { CountedFree(p); }
+void operator delete[](void *p) noexcept { CountedFree(p); }
+void operator delete(void *p, size_t) noexcept { CountedFree(p); }
+void operator delete[](void *p, size_t) noexcept { CountedFree(p); }
+void operator delete(void *p, std::align_val_t) noexcept { CountedFree(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { CountedFree(p); }
+void operator delete(void *p, size_t, std::align_val_t) noexcept {
+  CountedFree(p);
+}
+void operator delete[](void *p, size_t, std::align_val_t) noexcept {
+  CountedFree(p);
+}
+void operator delete(void *p, const std::nothrow_t &) noexcept {
+  CountedFree(p);
+}
+void operator delete[](void *p, const std::nothrow_t &) noexcept {
+  CountedFree(p);
+}
+void operator delete(void *p, std::align_val_t,
+                     const std::nothrow_t &) noexcept {
+  CountedFree(p);
+}
+void operator delete[](void *p, std::align_val_t,
+                       const std::nothrow_t &) noexcept {
+  CountedFree(p);
+}
+#endif
+
+int64_t HeapAllocations() {
+#ifdef DEBUG
+  return heapAllocations.load(std::memory_order_relaxed);
+#else
+  return 0;
+#endif
+}
+
+void *ArenaAlloc(FrameArena &arena, size_t size, size_t align) {
+  arena.wanted += size + align - 1;
+  const uintptr_t base = uintptr_t(arena.buffer.data());
+  const size_t offset = ((base + arena.used + align - 1) & ~(align - 1)) - base;
+  if (offset + size <= arena.buffer.size()) {
+    arena.used = offset + size;
+    return arena.buffer.data() + offset;
+  }
+  size_t space = size + align - 1;
+  auto &block = arena.overflow.emplace_back(
+      std::make_unique_for_overwrite<std::byte[]>(space));
+  void *p = block.get();
+  return std::align(align, size, p, space);
+}
+
+void ResetArena(FrameArena &arena) {
+  if (!arena.overflow.empty()) {
+    arena.overflow.clear();
+    const size_t size = std::max(arena.wanted, arena.buffer.size());
+    arena.buffer.resize(std::bit_ceil(std::max(size, MinArenaSize)));
+  }
+  arena.used = 0;
+  arena.wanted = 0;
+}
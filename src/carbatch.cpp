@@ -0,0 +1,226 @@
+#include "game.hpp"
+
+// C
+#include <cmath>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+// Batched version of UpdateCar over a CarBatch, 8 (AVX2), 4 (SSE2) or 1 car
+// at a time. Trig and exp are polynomial approximations evaluated with the
+// same operations on every backend. The build turns off FMA contraction
+// (-ffp-contract=off), so every backend gives bit identical results and
+// replays and netplay work across builds. Starting from the same state, one
+// tick stays within 1e-6 of UpdateCar (relative, absolute for magnitudes
+// below 1); delta being a difference of positions, it only matches at the
+// scale of pos.
+
+namespace {
+
+struct F1 {
+  float v;
+  static constexpr size_t Width = 1;
+  static F1 Set(float f) { return {f}; }
+  static F1 Load(const float *p) { return {*p}; }
+  void Store(float *p) const { *p = v; }
+};
+
+inline F1 operator+(F1 a, F1 b) { return {a.v + b.v}; }
+inline F1 operator-(F1 a, F1 b) { return {a.v - b.v}; }
+inline F1 operator*(F1 a, F1 b) { return {a.v * b.v}; }
+inline F1 operator/(F1 a, F1 b) { return {a.v / b.v}; }
+inline F1 Min(F1 a, F1 b) { return {std::min(a.v, b.v)}; }
+inline F1 Max(F1 a, F1 b) { return {std::max(a.v, b.v)}; }
+inline F1 Abs(F1 a) { return {fabsf(a.v)}; }
+inline F1 Sqrt(F1 a) { return {sqrtf(a.v)}; }
+inline F1 Round(F1 a) { return {nearbyintf(a.v)}; }
+inline F1 Floor(F1 a) { return {floorf(a.v)}; }
+inline F1 Select(F1 m, F1 a, F1 b) { return m.v != 0.0f ? a : b; }
+inline F1 Equal(F1 a, F1 b) { return {a.v == b.v ? 1.0f : 0.0f}; }
+inline F1 Or(F1 a, F1 b) { return {std::max(a.v, b.v)}; }
+inline F1 Pow2i(F1 n) { return {ldexpf(1.0f, int(n.v))}; }
+
+#if defined(__AVX2__)
+
+struct F8 {
+  __m256 v;
+  static constexpr size_t Width = 8;
+  static F8 Set(float f) { return {_mm256_set1_ps(f)}; }
+  static F8 Load(const float *p) { return {_mm256_loadu_ps(p)}; }
+  void Store(float *p) const { _mm256_storeu_ps(p, v); }
+};
+
+inline F8 operator+(F8 a, F8 b) { return {_mm256_add_ps(a.v, b.v)}; }
+inline F8 operator-(F8 a, F8 b) { return {_mm256_sub_ps(a.v, b.v)}; }
+inline F8 operator*(F8 a, F8 b) { return {_mm256_mul_ps(a.v, b.v)}; }
+inline F8 operator/(F8 a, F8 b) { return {_mm256_div_ps(a.v, b.v)}; }
+inline F8 Min(F8 a, F8 b) { return {_mm256_min_ps(a.v, b.v)}; }
+inline F8 Max(F8 a, F8 b) { return {_mm256_max_ps(a.v, b.v)}; }
+inline F8 Abs(F8 a) { return {_mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v)}; }
+inline F8 Sqrt(F8 a) { return {_mm256_sqrt_ps(a.v)}; }
+inline F8 Round(F8 a) {
+  return {_mm256_round_ps(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)};
+}
+inline F8 Floor(F8 a) { return {_mm256_floor_ps(a.v)}; }
+inline F8 Select(F8 m, F8 a, F8 b) { return {_mm256_blendv_ps(b.v, a.v, m.v)}; }
+inline F8 Equal(F8 a, F8 b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_EQ_OQ)}; }
+inline F8 Or(F8 a, F8 b) { return {_mm256_or_ps(a.v, b.v)}; }
+inline F8 Pow2i(F8 n) {
+  const __m256i e = _mm256_add_epi32(_mm256_cvtps_epi32(n.v),
+                                     _mm256_set1_epi32(127));
+  return {_mm256_castsi256_ps(_mm256_slli_epi32(e, 23))};
+}
+
+using FN = F8;
+
+#elif defined(__SSE2__) || defined(_M_X64)
+
+struct F4 {
+  __m128 v;
+  static constexpr size_t Width = 4;
+  static F4 Set(float f) { return {_mm_set1_ps(f)}; }
+  static F4 Load(const float *p) { return {_mm_loadu_ps(p)}; }
+  void Store(float *p) const { _mm_storeu_ps(p, v); }
+};
+
+inline F4 operator+(F4 a, F4 b) { return {_mm_add_ps(a.v, b.v)}; }
+inline F4 operator-(F4 a, F4 b) { return {_mm_sub_ps(a.v, b.v)}; }
+inline F4 operator*(F4 a, F4 b) { return {_mm_mul_ps(a.v, b.v)}; }
+inline F4 operator/(F4 a, F4 b) { return {_mm_div_ps(a.v, b.v)}; }
+inline F4 Min(F4 a, F4 b) { return {_mm_min_ps(a.v, b.v)}; }
+inline F4 Max(F4 a, F4 b) { return {_mm_max_ps(a.v, b.v)}; }
+inline F4 Abs(F4 a) { return {_mm_andnot_ps(_mm_set1_ps(-0.0f), a.v)}; }
+inline F4 Sqrt(F4 a) { return {_mm_sqrt_ps(a.v)}; }
+inline F4 Round(F4 a) {
+  return {_mm_cvtepi32_ps(_mm_cvtps_epi32(a.v))};
+}
+inline F4 Select(F4 m, F4 a, F4 b) {
+  return {_mm_or_ps(_mm_and_ps(m.v, a.v), _mm_andnot_ps(m.v, b.v))};
+}
+inline F4 Equal(F4 a, F4 b) { return {_mm_cmpeq_ps(a.v, b.v)}; }
+inline F4 Or(F4 a, F4 b) { return {_mm_or_ps(a.v, b.v)}; }
+inline F4 Floor(F4 a) {
+  const F4 r = Round(a);
+  return Select({_mm_cmpgt_ps(r.v, a.v)}, r - F4::Set(1.0f), r);
+}
+inline F4 Pow2i(F4 n) {
+  const __m128i e =
+      _mm_add_epi32(_mm_cvtps_epi32(n.v), _mm_set1_epi32(127));
+  return {_mm_castsi128_ps(_mm_slli_epi32(e, 23))};
+}
+
+using FN = F4;
+
+#else
+
+using FN = F1;
+
+#endif
+
+// exp(x) for x <= 0, 2^n * 2^f with a degree 5 polynomial for 2^f on [0, 1)
+template <typename F> F Exp(F x) {
+  const F y = Max(x * F::Set(1.44269504f), F::Set(-126.0f));
+  const F n = Floor(y);
+  const F f = y - n;
+  F p = F::Set(1.86546938e-3f);
+  p = p * f + F::Set(9.02025588e-3f);
+  p = p * f + F::Set(5.57979569e-2f);
+  p = p * f + F::Set(2.40164801e-1f);
+  p = p * f + F::Set(6.93151295e-1f);
+  p = p * f + F::Set(1.0f);
+  return p * Pow2i(n);
+}
+
+// sin and cos with a reduction to [-pi/4, pi/4] by quadrant
+template <typename F> void SinCos(F x, F &s, F &c) {
+  const F q = Round(x * F::Set(0.63661977f));
+  const F r = x - q * F::Set(1.5703125f) - q * F::Set(4.83826792e-4f) -
+              q * F::Set(2.56328292e-12f);
+  const F r2 = r * r;
+  F ps = F::Set(-1.9515296e-4f);
+  ps = ps * r2 + F::Set(8.3321609e-3f);
+  ps = ps * r2 + F::Set(-1.6666654e-1f);
+  ps = ps * r2 * r + r;
+  F pc = F::Set(2.4433157e-5f);
+  pc = pc * r2 + F::Set(-1.3887316e-3f);
+  pc = pc * r2 + F::Set(4.1666646e-2f);
+  pc = pc * r2 * r2 - F::Set(0.5f) * r2 + F::Set(1.0f);
+  const F qm = q - F::Set(4.0f) * Floor(q * F::Set(0.25f));
+  const F swap = Or(Equal(qm, F::Set(1.0f)), Equal(qm, F::Set(3.0f)));
+  const F negS = Or(Equal(qm, F::Set(2.0f)), Equal(qm, F::Set(3.0f)));
+  const F negC = Or(Equal(qm, F::Set(1.0f)), Equal(qm, F::Set(2.0f)));
+  const F ss = Select(swap, pc, ps);
+  const F cc = Select(swap, ps, pc);
+  s = Select(negS, F::Set(0.0f) - ss, ss);
+  c = Select(negC, F::Set(0.0f) - cc, cc);
+}
+
+template <typename F> void UpdateCarsN(CarBatch &b, size_t i, float k) {
+  const F zero = F::Set(0.0f);
+  const F one = F::Set(1.0f);
+  const F cwheel = F::Load(&b.cwheel[i]);
+  const F cthrust = F::Load(&b.cthrust[i]);
+  const F brake = F::Load(&b.brake[i]);
+  const F grip = F::Load(&b.grip[i]);
+  const F posX = F::Load(&b.posX[i]);
+  const F posY = F::Load(&b.posY[i]);
+  F speedX = F::Load(&b.speedX[i]);
+  F speedY = F::Load(&b.speedY[i]);
+  F thrust = F::Load(&b.thrust[i]);
+  F dir = F::Load(&b.dir[i]);
+
+  const F len = Sqrt(speedX * speedX + speedY * speedY);
+  const F vl = F::Set(2.0f) * (one - Exp(F::Set(-0.2f) * len));
+  const F cs = F::Set(0.01f) * vl;
+  F dx, dy;
+  SinCos(dir, dy, dx);
+  const F fk = F::Set(k);
+  const F thrustK = F::Set(GrassThrust) + F::Set(1.0f - GrassThrust) * grip;
+  const F acc = F::Set(0.4f) * (thrust / F::Set(100.0f)) * thrustK * fk;
+  const F dec = F::Set(0.2f) * (one - cthrust) * brake * fk;
+  thrust = Max(zero, thrust - F::Set(5.0f) * brake * fk);
+  thrust = thrust + cthrust * Exp(F::Set(-0.001f) * thrust) * fk;
+  thrust = Max(zero, thrust - (one - cthrust) * fk);
+  const F slide =
+      Min(one, (F::Set(0.4f) * brake + F::Set(0.1f) * cthrust) *
+                   (one + Abs(cwheel)));
+  dir = dir + cs * (one + F::Set(0.3f) * brake) * cwheel * fk;
+  const F dsGrass = F::Set(powf(GrassDrag, k));
+  const F ds = dsGrass + (F::Set(powf(0.98f, k)) - dsGrass) * grip;
+  speedX = ds * speedX + (acc - dec) * dx;
+  speedY = ds * speedY + (acc - dec) * dy;
+  const F step = F::Set(0.5f * k * GameScale);
+  const F nposX = posX + step * speedX;
+  const F nposY = posY + step * speedY;
+
+  (nposX - posX).Store(&b.deltaX[i]);
+  (nposY - posY).Store(&b.deltaY[i]);
+  nposX.Store(&b.posX[i]);
+  nposY.Store(&b.posY[i]);
+  speedX.Store(&b.speedX[i]);
+  speedY.Store(&b.speedY[i]);
+  thrust.Store(&b.thrust[i]);
+  dir.Store(&b.dir[i]);
+  slide.Store(&b.slide[i]);
+}
+
+} // namespace
+
+void ResizeCarBatch(CarBatch &batch, size_t count) {
+  for (auto *v : {&batch.posX, &batch.posY, &batch.deltaX, &batch.deltaY,
+                  &batch.speedX, &batch.speedY, &batch.thrust, &batch.dir,
+                  &batch.slide, &batch.cwheel, &batch.cthrust, &batch.brake,
+                  &batch.grip})
+    v->resize(count);
+}
+
+void UpdateCars(CarBatch &batch, size_t count, float k) {
+  size_t i = 0;
+  for (; i + FN::Width <= count; i += FN::Width)
+    UpdateCarsN<FN>(batch, i, k);
+  for (; i < count; ++i)
+    UpdateCarsN<F1>(batch, i, k);
+}
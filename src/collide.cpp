@@ -0,0 +1,167 @@
+#include "game.hpp"
+
+// Cars are oriented boxes of the footprint the particles spawn from, props
+// are circles of their trunk radius. Car pairs come from a spatial hash with
+// cells as wide as two car radii, so overlapping cars sit in neighboring
+// cells; props from the track's static grid. Overlaps are pushed apart along
+// the axis of least penetration and the closing speed is bounced back.
+
+namespace {
+
+// bounce of the closing speed and thrust kept after hitting a prop
+constexpr float Restitution = 0.3f;
+constexpr float PropThrustKept = 0.5f;
+
+const float CarRadius = Vector2Length({CarHalfLength, CarHalfWidth});
+
+struct Box {
+  Vector2 center{};
+  Vector2 axis[2]{};
+  float half[2]{CarHalfLength, CarHalfWidth};
+};
+
+Box CarBox(const CarData &car, Vector2 d) {
+  return {.center = car.pos, .axis = {d, {-d.y, d.x}}};
+}
+
+float ProjectBox(const Box &b, Vector2 n) {
+  return b.half[0] * abs(Vector2DotProduct(b.axis[0], n)) +
+         b.half[1] * abs(Vector2DotProduct(b.axis[1], n));
+}
+
+// separating axis test, the normal points from a to b
+std::optional<std::pair<Vector2, float>> BoxOverlap(const Box &a,
+                                                    const Box &b) {
+  const Vector2 ab = b.center - a.center;
+  std::pair<Vector2, float> best{{}, INFINITY};
+  for (const Vector2 n : {a.axis[0], a.axis[1], b.axis[0], b.axis[1]}) {
+    const float d = Vector2DotProduct(ab, n);
+    const float depth = ProjectBox(a, n) + ProjectBox(b, n) - abs(d);
+    if (depth <= 0.0f)
+      return std::nullopt;
+    if (depth < best.second)
+      best = {d < 0.0f ? Vector2Negate(n) : n, depth};
+  }
+  return best;
+}
+
+// the normal points from the circle to the box
+std::optional<std::pair<Vector2, float>> CircleOverlap(const Box &b, Vector2 p,
+                                                       float r) {
+  const Vector2 rel = p - b.center;
+  float local[2];
+  float clamped[2];
+  for (int i = 0; i < 2; ++i) {
+    local[i] = Vector2DotProduct(rel, b.axis[i]);
+    clamped[i] = Clamp(local[i], -b.half[i], b.half[i]);
+  }
+  const Vector2 diff = (local[0] - clamped[0]) * b.axis[0] +
+                       (local[1] - clamped[1]) * b.axis[1];
+  const float dist = Vector2Length(diff);
+  if (dist >= r)
+    return std::nullopt;
+  if (dist > 0.0f)
+    return std::pair{(-1.0f / dist) * diff, r - dist};
+  // center inside the box, out through the nearest side
+  const int i = b.half[0] - abs(local[0]) < b.half[1] - abs(local[1]) ? 0 : 1;
+  const float side = local[i] < 0.0f ? 1.0f : -1.0f;
+  return std::pair{side * b.axis[i], b.half[i] - abs(local[i]) + r};
+}
+
+// moves the car keeping its previous position, so pos - delta still is
+void Push(CarData &car, Vector2 v) {
+  car.pos = car.pos + v;
+  car.delta = car.delta + v;
+}
+
+std::array<int, 2> HashCell(Vector2 p) {
+  return {int(floorf(p.x / (2.0f * CarRadius))),
+          int(floorf(p.y / (2.0f * CarRadius)))};
+}
+
+int HashBucket(std::array<int, 2> c, int mask) {
+  return int((uint32_t(c[0]) * 73856093u ^ uint32_t(c[1]) * 19349663u) &
+             uint32_t(mask));
+}
+
+void BuildCarHash(CarHash &hash, std::span<const Car> cars) {
+  const int buckets = int(std::bit_ceil(std::max<size_t>(2 * cars.size(), 1)));
+  hash.cellStart.assign(buckets + 1, 0);
+  hash.cells.resize(cars.size());
+  hash.dirs.resize(cars.size());
+  for (size_t i = 0; i < cars.size(); ++i) {
+    hash.cells[i] = HashCell(cars[i].data.pos);
+    hash.dirs[i] = {cosf(cars[i].data.dir), sinf(cars[i].data.dir)};
+    hash.cellStart[HashBucket(hash.cells[i], buckets - 1) + 1] += 1;
+  }
+  for (int b = 1; b <= buckets; ++b)
+    hash.cellStart[b] += hash.cellStart[b - 1];
+  hash.fill.assign(hash.cellStart.begin(), hash.cellStart.end() - 1);
+  hash.items.resize(cars.size());
+  for (size_t i = 0; i < cars.size(); ++i)
+    hash.items[hash.fill[HashBucket(hash.cells[i], buckets - 1)]++] = int(i);
+}
+
+void CollidePair(CarData &a, Vector2 da, CarData &b, Vector2 db) {
+  const auto hit = BoxOverlap(CarBox(a, da), CarBox(b, db));
+  if (!hit)
+    return;
+  const auto [n, depth] = *hit;
+  Push(a, -0.5f * depth * n);
+  Push(b, 0.5f * depth * n);
+  const float closing = Vector2DotProduct(b.speed - a.speed, n);
+  if (closing < 0.0f) {
+    const float j = 0.5f * (1.0f + Restitution) * closing;
+    a.speed = a.speed + j * n;
+    b.speed = b.speed - j * n;
+  }
+}
+
+void CollideProps(const Track &track, CarData &car, Vector2 dir) {
+  const float reach = CarRadius + track.trunkRadius;
+  const Rectangle area{car.pos.x - reach, car.pos.y - reach, 2.0f * reach,
+                       2.0f * reach};
+  QueryGrid(track.propGrid, area, [&](int i) {
+    const auto &[pos, scale, mdl] = track.props[i];
+    const Vector2 p{pos.x, pos.z};
+    const float r = TrunkRadius * scale;
+    if (Vector2DistanceSqr(p, car.pos) >= (CarRadius + r) * (CarRadius + r))
+      return;
+    const auto hit = CircleOverlap(CarBox(car, dir), p, r);
+    if (!hit)
+      return;
+    const auto [n, depth] = *hit;
+    Push(car, depth * n);
+    const float closing = Vector2DotProduct(car.speed, n);
+    if (closing < 0.0f) {
+      car.speed = car.speed - (1.0f + Restitution) * closing * n;
+      car.thrust *= PropThrustKept;
+    }
+  });
+}
+
+} // namespace
+
+// each pair is tested once: from the lower index, in the bucket of the
+// neighbor cell the other car actually is in
+void CollideCars(SimState &sim) {
+  CarHash &hash = sim.carHash;
+  BuildCarHash(hash, sim.cars);
+  const int mask = int(hash.cellStart.size()) - 2;
+  for (size_t i = 0; i < sim.cars.size(); ++i) {
+    const auto [cx, cy] = hash.cells[i];
+    for (int y = cy - 1; y <= cy + 1; ++y) {
+      for (int x = cx - 1; x <= cx + 1; ++x) {
+        const int b = HashBucket({x, y}, mask);
+        for (int k = hash.cellStart[b]; k < hash.cellStart[b + 1]; ++k) {
+          const int j = hash.items[k];
+          if (j > int(i) && hash.cells[j] == std::array{x, y})
+            CollidePair(sim.cars[i].data, hash.dirs[i], sim.cars[j].data,
+                        hash.dirs[j]);
+        }
+      }
+    }
+  }
+  for (size_t i = 0; i < sim.cars.size(); ++i)
+    CollideProps(*sim.track, sim.cars[i].data, hash.dirs[i]);
+}
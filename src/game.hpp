@@ -3,13 +3,25 @@
 // C
 #include <cstdint>
 #include <cstdio>
+#include <cstring>
 
 // C++
 #include <algorithm>
 #include <array>
+#include <atomic>
+#include <bit>
+#include <condition_variable>
+#include <deque>
+#include <functional>
 #include <iterator>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <span>
+#include <string>
+#include <thread>
+#include <type_traits>
 #include <vector>
 
 // raylib
@@ -18,9 +30,40 @@
 #include <rlgl.h>
 
 constexpr double PLifeTime = 1.5;
+constexpr size_t MaxParticles = 4096;
 constexpr float GameScale = 0.1f;
+// half extents of the car footprint, along and across its direction
+constexpr float CarHalfLength = GameScale * 25.0f;
+constexpr float CarHalfWidth = GameScale * 15.0f;
+// trunk radius of the props per unit of scale
+constexpr float TrunkRadius = 1.0f;
+constexpr float RoadHalfWidth = GameScale * 250.0f;
+// world size of one repeat of the baked ground texture
+constexpr float GroundTile = 512.0f;
+// speed kept per tick and thrust on the grass, 0.98 and 1 on the road
+constexpr float GrassDrag = 0.96f;
+constexpr float GrassThrust = 0.8f;
+// the handling coefficients are tuned for ticks of 1 / BaseTickRate seconds
+constexpr int BaseTickRate = 60;
+
+// xorshift32, reproducible from a seed on every platform
+struct Rng {
+  uint32_t state{0x9e3779b9u};
+  uint32_t Next() {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+  }
+  int Range(int lo, int hi) {
+    return lo + int(Next() % uint32_t(hi - lo + 1));
+  }
+};
+
+inline Rng MakeRng(uint32_t seed) { return {seed != 0 ? seed : 0x9e3779b9u}; }
 
 enum class State {
+  Loading,
   Main,
   PlayerSelect,
   Race,
@@ -34,6 +77,17 @@ struct CarInputs {
   float handbrake{};
 };
 
+// analog wheel on 8 bits and buttons on/off, so replays play back exactly
+inline CarInputs QuantizeInputs(const CarInputs &in) {
+  const auto button = [](float v) { return v > 0.5f ? 1.0f : 0.0f; };
+  return {
+      .cwheel = roundf(Clamp(in.cwheel, -1.0f, 1.0f) * 127.0f) / 127.0f,
+      .cthrust = button(in.cthrust),
+      .brake = button(in.brake),
+      .handbrake = button(in.handbrake),
+  };
+}
+
 struct CarData {
   Vector2 pos{};
   Vector2 delta{};
@@ -43,66 +97,453 @@ struct CarData {
   float slide{};
 };
 
+// position relative to the track: arc length along the center line, signed
+// distance to it along the normal, and the TrackSpace segment it projects on
+struct TrackPos {
+  float s{};
+  float lateral{};
+  int segment{};
+};
+
 struct Car {
   CarInputs inputs{};
   CarData data{};
+  float lastDir{};
+  TrackPos trackPos{};
   int model{};
   std::optional<int> playerIndex{};
 };
 
+// structure-of-arrays copy of the cars physics state, advanced in batch by
+// UpdateCars
+struct CarBatch {
+  std::vector<float> posX{}, posY{};
+  std::vector<float> deltaX{}, deltaY{};
+  std::vector<float> speedX{}, speedY{};
+  std::vector<float> thrust{}, dir{}, slide{};
+  std::vector<float> cwheel{}, cthrust{}, brake{}, grip{};
+};
+
 struct Player {
   bool enabled{};
   int gamepad{};
   int lastCP{-1};
+  int laps{};
   std::optional<int> startFrame{};
   std::optional<int> bestChrono{};
 };
 
-struct Particle {
-  Vector2 pos{};
-  Vector2 speed{};
-  double t{};
-  float str{};
+// ring of particles in spawn order, so they expire from the front; when full
+// the oldest one is overwritten
+struct Particles {
+  std::array<Vector2, MaxParticles> pos{};
+  std::array<Vector2, MaxParticles> speed{};
+  std::array<double, MaxParticles> t{};
+  std::array<float, MaxParticles> str{};
+  size_t first{};
+  size_t count{};
+  size_t dropped{};
 };
 
+// gate from pos - delta to pos + delta, normal and axis (delta / |delta|^2)
+// are baked by MakeCheckpoint
 struct Checkpoint {
   Vector2 pos{};
   Vector2 delta{};
+  Vector2 normal{};
+  Vector2 axis{};
+};
+
+// uniform grid over a rectangle, each cell listing the items overlapping it;
+// items outside the rectangle are kept in the border cells
+struct SpatialGrid {
+  Rectangle bounds{};
+  float cellSize{};
+  int cols{};
+  int rows{};
+  std::vector<int> cellStart{};
+  std::vector<int> items{};
+};
+
+// signed distance to the road edge sampled at the nodes of a grid over the
+// track, quantized to int8, for a constant time grip lookup
+struct SurfaceGrid {
+  Rectangle bounds{};
+  float cellSize{};
+  int cols{};
+  int rows{};
+  std::vector<int8_t> dist{};
+};
+
+struct MeshData {
+  std::vector<Vector3> vertice{};
+  std::vector<Vector2> uvs{};
+  std::vector<Color> colors{};
+  std::vector<uint16_t> indice{};
+};
+
+// car model as slices of a sprite sheet, stacked into voxels
+struct Voxel {
+  int texId{};
+  float x{}, y{}, w{}, h{};
+  int depth{};
+  float lwidth{};
+  bool xySwap{};
+};
+
+constexpr std::array<Voxel, 2> CarVoxels{{
+    {0, 7, 10, 16, 7, 6, 32, false},
+    {1, 12, 6, 7, 19, 5, 32, true},
+}};
+
+// sprite sheets assets/car00.png, assets/car01.png, ...
+constexpr int CarTextureCount = 2;
+
+// center line resampled at a constant arc length step
+struct TrackSpace {
+  std::vector<Vector2> pos{};
+  std::vector<Vector2> normal{};
+  float step{};
+  float length{};
+};
+
+// path the bots follow, sampled every step of arc length of the track space,
+// with the speed to keep at each sample
+struct RacingLine {
+  float step{};
+  std::vector<Vector2> pos{};
+  std::vector<float> speed{};
+};
+
+// piece of road mesh covering a range of the track, culled as a whole
+struct RoadChunk {
+  Rectangle aabb{};
+  MeshData mesh{};
+  Model model{};
 };
 
 struct Track {
   std::vector<Vector2> track{};
-  std::vector<Model> models{};
+  TrackSpace space{};
+  RacingLine line{};
+  std::vector<RoadChunk> road{};
   std::vector<std::tuple<Vector3, float, Model *>> props{};
+  SpatialGrid propGrid{};
+  float propRadius{};
+  float trunkRadius{};
   std::vector<Checkpoint> checkpoints{};
+  SpatialGrid checkpointGrid{};
+  SurfaceGrid surface{};
   Rectangle aabb{};
 };
 
+// props sharing a model, drawn with one instanced call per mesh
+struct PropBatch {
+  const Model *model{};
+  std::vector<Material> materials{};
+};
+
+struct CarInstance {
+  int model{};
+  Matrix transform{};
+};
+
+constexpr int HudFontSize = 20;
+constexpr int HudLines = 4;
+
+// a HUD string as the glyph quads of the default font (source, then
+// destination from the text origin), kept while the value it shows is
+// unchanged
+struct HudText {
+  int64_t value{INT64_MIN};
+  std::vector<std::array<Rectangle, 2>> quads{};
+};
+
+// everything a view draws that depends on the frame, built off the main
+// thread and replayed into GL by the main thread
+struct ViewDrawList {
+  Camera3D cam{};
+  Rectangle ground{};
+  std::vector<int> road{};
+  std::vector<std::vector<Matrix>> props{};
+  std::vector<CarInstance> cars{};
+  std::vector<Matrix> particles{};
+  // retained across frames, hudCount lines from the top left of the view
+  std::array<HudText, HudLines> hud{};
+  int hudCount{};
+  Vector2 hudOrigin{};
+  int propCount{};
+  int propTested{};
+};
+
+// worker threads for ParallelFor, the calling thread runs items too
+struct JobPool {
+  std::vector<std::thread> workers{};
+  std::mutex mutex{};
+  std::condition_variable wake{};
+  std::condition_variable idle{};
+  const std::function<void(size_t)> *job{};
+  size_t count{};
+  std::atomic<size_t> next{};
+  std::atomic<size_t> finished{};
+  int busy{};
+  uint64_t generation{};
+  bool quit{};
+};
+
+enum class Stage {
+  Input,
+  Particles,
+  Physics,
+  Collisions,
+  Checkpoints,
+  Prepare,
+  View,
+  Composite,
+  Minimap,
+  Count,
+};
+
+struct ProfileEvent {
+  int64_t start{};
+  int64_t end{};
+  Stage stage{};
+  int index{};
+};
+
+// per stage times of the last frames and a ring of the last events, only
+// filled while enabled
+struct Profiler {
+  static constexpr size_t FrameCount = 240;
+  static constexpr size_t EventCount = 4096;
+  bool enabled{};
+  size_t frame{};
+  std::array<std::array<float, size_t(Stage::Count)>, FrameCount> frames{};
+  std::array<ProfileEvent, EventCount> events{};
+  size_t eventCount{};
+};
+
+// cars bucketed by cell of a hash table rebuilt each tick, cellStart and
+// items laid out as in SpatialGrid, with the cell and direction of each car
+struct CarHash {
+  std::vector<int> cellStart{};
+  std::vector<int> items{};
+  std::vector<std::array<int, 2>> cells{};
+  std::vector<Vector2> dirs{};
+  std::vector<int> fill{};
+};
+
+// what a tick changes besides the cars, trivially copyable so that saving
+// and restoring it are a copy
+struct SimCore {
+  std::array<Player, 4> players{};
+  Particles particles{};
+  std::optional<int> bestChrono{};
+  double gtime{};
+  int frame{};
+  Rng rng{};
+};
+
+struct SimState : SimCore {
+  const Track *track{};
+  Profiler *profiler{};
+  std::vector<Car> cars{};
+  int tickRate{BaseTickRate};
+  CarBatch batch{};
+  CarHash carHash{};
+};
+
+// SimState at the start of a tick
+struct SimSnapshot {
+  SimCore core{};
+  std::vector<Car> cars{};
+};
+
+static_assert(std::is_trivially_copyable_v<SimCore>);
+static_assert(std::is_trivially_copyable_v<Car>);
+
+// ticks simulated ahead of the last input received from the peer, and size
+// of the input history
+constexpr int NetMaxRollback = 16;
+constexpr int NetHistory = 64;
+
+// Rollback netplay between two peers over UDP, each driving one player. The
+// local inputs apply at once, the remote ones are predicted by repeating the
+// last received; when they arrive different, the sim is restored to the
+// first mispredicted tick and simulated again up to the present.
+struct NetPlay {
+  intptr_t socket{-1};
+  std::array<uint8_t, 16> peer{};
+  int localPlayer{};
+  int remotePlayer{};
+  // index of the local player's car, set by StartNetPlay
+  int localCar{-1};
+  // by tick % NetHistory, local then remote
+  std::array<std::array<CarInputs, 2>, NetHistory> inputs{};
+  // by tick % (NetMaxRollback + 1)
+  std::vector<SimSnapshot> snapshots{};
+  std::vector<CarInputs> tickInputs{};
+  // remote inputs received for ticks [0, remoteTicks), local inputs the
+  // peer received for ticks [0, remoteAck)
+  int remoteTicks{};
+  int remoteAck{};
+  std::optional<int> rollbackFrom{};
+  int rollbacks{};
+  int resimulated{};
+  int lastRollback{};
+};
+
+struct MappedFile {
+  const uint8_t *data{};
+  size_t size{};
+  intptr_t handle{};
+};
+
+struct ReplayHeader {
+  char magic[4]{'M', 'R', 'P', 'L'};
+  uint32_t version{2};
+  uint32_t tickRate{};
+  uint32_t trackSeed{};
+  uint32_t carCount{};
+  uint32_t tickCount{};
+  uint32_t keyframeInterval{};
+  uint32_t keyframeCount{};
+  uint32_t keyframeOffset{};
+  uint32_t keyframeSize{};
+  uint32_t streamOffset{};
+};
+
+// records the quantized inputs of every car for every tick, as runs of
+// unchanged ticks and per car deltas, plus a keyframe of the sim state every
+// ReplayKeyframeInterval ticks to seek from
+struct ReplayWriter {
+  ReplayHeader header{};
+  std::vector<uint8_t> cars{};
+  std::vector<uint8_t> stream{};
+  std::vector<uint8_t> keyframes{};
+  std::vector<CarInputs> last{};
+  int run{};
+};
+
+struct ReplayReader {
+  MappedFile file{};
+  ReplayHeader header{};
+  // read position in the input stream, which ends at end
+  size_t offset{};
+  size_t end{};
+  int tick{};
+  int run{};
+  std::vector<CarInputs> last{};
+};
+
+constexpr float MinRenderScale = 0.5f;
+
+// scale of the views resolution, from averaged frame and render work times
+struct DynamicResolution {
+  float scale{1.0f};
+  float frameTime{};
+  float workTime{};
+  int stable{};
+  int backoff{1};
+  float failed{INFINITY};
+  bool raised{};
+};
+
+struct Context;
+struct Loader;
+using LoadTask = std::function<void(Loader &)>;
+using UploadItem = std::function<void(Context &)>;
+
+// Tasks run on the loader pool, driven from a thread so the main loop keeps
+// going. They queue their GPU uploads, which the main thread runs a few per
+// frame.
+struct Loader {
+  JobPool pool{};
+  std::thread driver{};
+  std::mutex mutex{};
+  std::deque<UploadItem> uploads{};
+  std::optional<Track> track{};
+  std::atomic<int> tasksDone{};
+  std::atomic<int> uploadsQueued{};
+  std::atomic<bool> cpuDone{};
+  int taskCount{};
+  int uploadsDone{};
+  State next{};
+};
+
+// Bump allocated scratch memory for the main thread, all released by
+// ResetArena at the top of each frame. What does not fit goes to overflow
+// blocks, and the next reset grows the buffer to cover it, so a steady frame
+// takes no memory from the heap.
+struct FrameArena {
+  std::vector<std::byte> buffer{};
+  size_t used{};
+  size_t wanted{};
+  std::vector<std::unique_ptr<std::byte[]>> overflow{};
+};
+
+void *ArenaAlloc(FrameArena &arena, size_t size, size_t align);
+
+// for standard containers living within a frame, deallocate is a no-op
+template <typename T> struct ArenaAllocator {
+  using value_type = T;
+  FrameArena *arena{};
+
+  explicit ArenaAllocator(FrameArena &a) : arena(&a) {}
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U> &other) : arena(other.arena) {}
+  T *allocate(size_t n) {
+    return (T *)ArenaAlloc(*arena, n * sizeof(T), alignof(T));
+  }
+  void deallocate(T *, size_t) {}
+  template <typename U> bool operator==(const ArenaAllocator<U> &o) const {
+    return arena == o.arena;
+  }
+};
+
+template <typename T> using FrameVector = std::vector<T, ArenaAllocator<T>>;
+
 struct Context {
   const int W = 1280;
   const int H = 720;
-  State state{State::Main};
+  State state{State::Loading};
   Texture trackTex{};
-  std::vector<Texture> voxelTex{};
-  Texture noiseTex{};
-  std::map<int, int> ctrlToPlayer{};
-  std::vector<Car> cars{};
-  std::array<Player, 4> players{};
+  Texture groundTex{};
+  Texture roadTex{};
+  // by gamepad, 1 + the index of the player it drives or 0
+  std::array<int, 8> ctrlToPlayer{};
+  uint32_t trackSeed{};
+  std::optional<const char *> recordPath{};
+  std::optional<ReplayWriter> recorder{};
+  std::optional<ReplayReader> replay{};
+  std::optional<NetPlay> net{};
+  SimState sim{};
+  int botCount{};
+  double simTime{};
+  float simAlpha{};
+  std::vector<CarInputs> inputs{};
   bool pause{};
   Track track{};
   std::vector<int> checkPointsChrono{};
-  std::optional<int> bestChrono{};
   Shader shdGround{};
   Shader shdInstancing{};
   std::vector<Model> mdlCars{};
   Model mdlGround{};
   Model mdlParticle{};
   Model mdlTree{};
+  std::vector<PropBatch> propBatches{};
+  std::vector<int> propBatchIndex{};
   std::vector<RenderTexture> rts{};
-  std::vector<Particle> particles{};
-  double gtime{};
-  int frame{};
+  DynamicResolution resolution{};
+  int targetFps{60};
+  std::array<ViewDrawList, 4> drawLists{};
+  JobPool jobs{};
   bool showDebug{};
+  Profiler profiler{};
+  Loader loader{};
+  FrameArena frameArena{};
+  // heap allocations of the last frame, counted in DEBUG builds only
+  int64_t frameAllocations{};
 };
 
 inline Vector2 operator+(Vector2 v0, Vector2 v1) { return Vector2Add(v0, v1); }
@@ -125,7 +566,208 @@ inline std::optional<Vector2> deadZone(Vector2 v, float ml) {
 
 inline void SetState(Context &ctx, State s) { ctx.state = s; }
 
-void InitCars(Context &ctx);
+inline std::optional<const char *> GetArg(int argc, char **argv,
+                                          const char *name) {
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], name) != 0)
+      continue;
+    return std::make_optional(i + 1 < argc ? argv[i + 1] : "");
+  }
+  return {};
+}
+
+inline Checkpoint MakeCheckpoint(Vector2 pos, Vector2 delta) {
+  return {
+      .pos = pos,
+      .delta = delta,
+      .normal = Vector2Normalize({-delta.y, delta.x}),
+      .axis = (1.0f / Vector2LengthSqr(delta)) * delta,
+  };
+}
+
+// grid.cpp
+void BuildGrid(SpatialGrid &grid, Rectangle bounds, float cellSize,
+               std::span<const Rectangle> boxes);
+
+inline std::array<int, 4> GridRange(const SpatialGrid &grid, Rectangle area) {
+  const auto cell = [&](float v, float o, int count) {
+    return std::clamp(int((v - o) / grid.cellSize), 0, count - 1);
+  };
+  return {
+      cell(area.x, grid.bounds.x, grid.cols),
+      cell(area.y, grid.bounds.y, grid.rows),
+      cell(area.x + area.width, grid.bounds.x, grid.cols),
+      cell(area.y + area.height, grid.bounds.y, grid.rows),
+  };
+}
+
+// calls fn for each item of the cells overlapping area, an item spanning
+// several cells can be reported more than once
+template <typename Fn>
+void QueryGrid(const SpatialGrid &grid, Rectangle area, Fn &&fn) {
+  if (grid.cols == 0)
+    return;
+  const auto [x0, y0, x1, y1] = GridRange(grid, area);
+  for (int y = y0; y <= y1; ++y) {
+    const int row = y * grid.cols;
+    for (int i = grid.cellStart[row + x0]; i < grid.cellStart[row + x1 + 1];
+         ++i)
+      fn(grid.items[i]);
+  }
+}
+
+// trackspace.cpp
+TrackSpace MakeTrackSpace(const std::vector<Vector2> &points, float step);
+std::pair<Vector2, Vector2> SampleTrack(const TrackSpace &ts, float s);
+TrackPos ProjectOnTrack(const TrackSpace &ts, Vector2 p);
+TrackPos ProjectOnTrack(const TrackSpace &ts, Vector2 p, const TrackPos &hint);
+
+// init.cpp
+std::pair<Vector2, Vector2> GetSplineAndDir(const std::vector<Vector2> &points,
+                                            float r);
+std::vector<RoadChunk> MakeTrackRoad(const TrackSpace &ts, Vector2 width,
+                                     float chunkLength);
+std::vector<Vector2> MakeRandomTrack(uint32_t seed);
+Track MakeTrack(const std::vector<Vector2> &track, Model *propModel);
+Mesh MakeMesh(const MeshData &data);
+MeshData MakeVoxelMesh(const Voxel &vx, const Image &sheet);
+Image MakeGroundImage(const Image &noise);
+std::vector<LoadTask> LooseAssetTasks();
+LoadTask TrackTask(uint32_t seed, Model *propModel);
+void FinishLoad(Context &ctx);
+void MakePropBatches(Context &ctx);
+void InitCars(SimState &sim, int bots);
 void Init(Context &ctx, int argc, char **argv);
+
+// ai.cpp
+RacingLine MakeRacingLine(const TrackSpace &ts, float halfWidth);
+CarInputs DriveCar(const RacingLine &line, const Car &car);
+void DriveBots(const SimState &sim, std::span<CarInputs> inputs);
+
+// surface.cpp
+SurfaceGrid MakeSurfaceGrid(const TrackSpace &ts, float halfWidth,
+                            Rectangle bounds);
+float SurfaceGrip(const SurfaceGrid &grid, Vector2 p);
+
+// collide.cpp
+void CollideCars(SimState &sim);
+
+// carbatch.cpp
+void ResizeCarBatch(CarBatch &batch, size_t count);
+void UpdateCars(CarBatch &batch, size_t count, float k);
+
+// particles.cpp
+void SpawnParticle(Particles &ps, Vector2 pos, Vector2 speed, double t,
+                   float str);
+void UpdateParticles(Particles &ps, double gtime, float dt);
+
+template <typename Fn> void ForEachParticle(const Particles &ps, Fn &&fn) {
+  const size_t end = ps.first + ps.count;
+  for (size_t i = ps.first; i < std::min(end, MaxParticles); ++i)
+    fn(i);
+  for (size_t i = 0; i + MaxParticles < end; ++i)
+    fn(i);
+}
+
+// sim.cpp
+void UpdateCar(const CarInputs &inputs, CarData &car, float k, float grip);
+void UpdateCheckPoint(SimState &sim, Car &car, Vector2 lastPos,
+                      Vector2 newPos);
+void SimStep(SimState &sim, std::span<const CarInputs> inputs);
+void SaveSnapshot(const SimState &sim, SimSnapshot &snap);
+void RestoreSnapshot(SimState &sim, const SimSnapshot &snap);
+uint32_t SimChecksum(const SimState &sim);
+
+// mappedfile.cpp
+std::optional<MappedFile> MapFile(const char *path);
+void UnmapFile(MappedFile &file);
+
+// pack.cpp
+bool BakePack(const char *path);
+bool LoadPack(Loader &loader, const char *path);
+
+// loader.cpp
+void StartLoader(Loader &loader, int threads);
+void StopLoader(Loader &loader);
+void QueueUpload(Loader &loader, UploadItem item);
+void BeginLoad(Context &ctx, std::vector<LoadTask> tasks, State next);
+bool PumpLoader(Context &ctx, double budget);
+float LoadProgress(const Loader &loader);
+
+// replay.cpp
+constexpr int ReplayKeyframeInterval = 300;
+void BeginReplay(ReplayWriter &w, uint32_t trackSeed, const SimState &sim);
+void RecordTick(ReplayWriter &w, const SimState &sim,
+                std::span<const CarInputs> inputs);
+bool SaveReplay(ReplayWriter &w, const char *path);
+std::optional<ReplayReader> OpenReplay(const char *path);
+void CloseReplay(ReplayReader &r);
+void InitReplayCars(const ReplayReader &r, SimState &sim);
+bool ReadReplayTick(ReplayReader &r, std::span<CarInputs> inputs);
+void SeekReplay(ReplayReader &r, SimState &sim, int tick);
+
+// jobs.cpp
+void StartJobPool(JobPool &pool, int threads);
+void StopJobPool(JobPool &pool);
+void ParallelFor(JobPool &pool, size_t count,
+                 const std::function<void(size_t)> &fn);
+
+// minimap.cpp
+Image RasterizeMinimap(const Track &track, int size, JobPool &pool);
+
+// profiler.cpp
+int64_t ProfileNow();
+void BeginProfileFrame(Profiler &p);
+void EndProfile(Profiler &p, Stage stage, int index, int64_t start);
+void DrawProfileOverlay(const Profiler &p, int x, int y);
+bool SaveProfileTrace(const Profiler &p, const char *path);
+
+// times its scope as one stage, costs a branch when p is null or disabled
+struct ProfileScope {
+  Profiler *p{};
+  Stage stage{};
+  int index{};
+  int64_t start{};
+  ProfileScope(Profiler *p, Stage stage, int index = 0)
+      : p(p && p->enabled ? p : nullptr), stage(stage), index(index),
+        start(this->p ? ProfileNow() : 0) {}
+  ProfileScope(const ProfileScope &) = delete;
+  ProfileScope &operator=(const ProfileScope &) = delete;
+  ~ProfileScope() {
+    if (p)
+      EndProfile(*p, stage, index, start);
+  }
+};
+
+// hud.cpp
+void LayoutHudText(HudText &text, const char *str);
+void DrawHud(std::span<const ViewDrawList> lists);
+
+// formats and lays out the text only when value, the key of what it shows,
+// changed since the last call
+template <typename... T>
+void SetHudText(HudText &text, int64_t value, const char *fmt, T... args) {
+  if (value == text.value)
+    return;
+  char str[128]{};
+  snprintf(str, sizeof(str), fmt, args...);
+  text.value = value;
+  LayoutHudText(text, str);
+}
+
+// arena.cpp
+void ResetArena(FrameArena &arena);
+int64_t HeapAllocations();
+
+// netplay.cpp
+std::optional<NetPlay> OpenNetPlay(int port, const char *peer, int player);
+void CloseNetPlay(NetPlay &net);
+bool StartNetPlay(NetPlay &net, const SimState &sim);
+bool NetStep(NetPlay &net, SimState &sim, const CarInputs &local);
+bool NetSync(NetPlay &net, SimState &sim, int ticks);
+
+// headless.cpp
+int RunHeadless(int argc, char **argv);
+
 bool Update(Context &ctx);
 void Render(Context &ctx);
@@ -0,0 +1,27 @@
+#include "game.hpp"
+
+void BuildGrid(SpatialGrid &grid, Rectangle bounds, float cellSize,
+               std::span<const Rectangle> boxes) {
+  grid.bounds = bounds;
+  grid.cellSize = cellSize;
+  grid.cols = std::max(1, int(ceilf(bounds.width / cellSize)));
+  grid.rows = std::max(1, int(ceilf(bounds.height / cellSize)));
+  grid.cellStart.assign(grid.cols * grid.rows + 1, 0);
+
+  const auto forEachCell = [&](Rectangle box, auto &&fn) {
+    const auto [x0, y0, x1, y1] = GridRange(grid, box);
+    for (int y = y0; y <= y1; ++y)
+      for (int x = x0; x <= x1; ++x)
+        fn(y * grid.cols + x);
+  };
+
+  for (const Rectangle &box : boxes)
+    forEachCell(box, [&](int c) { grid.cellStart[c + 1] += 1; });
+  for (size_t c = 1; c < grid.cellStart.size(); ++c)
+    grid.cellStart[c] += grid.cellStart[c - 1];
+
+  grid.items.resize(grid.cellStart.back());
+  std::vector<int> fill(grid.cellStart.begin(), grid.cellStart.end() - 1);
+  for (size_t i = 0; i < boxes.size(); ++i)
+    forEachCell(boxes[i], [&](int c) { grid.items[fill[c]++] = int(i); });
+}
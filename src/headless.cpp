@@ -0,0 +1,142 @@
+#include "game.hpp"
+
+// C++
+#include <chrono>
+
+namespace {
+
+constexpr auto NetTimeout = std::chrono::seconds(10);
+
+// the local car drives itself, waiting on the peer when too far ahead
+bool RunNetPlay(NetPlay &net, SimState &sim, int ticks) {
+  if (!StartNetPlay(net, sim)) {
+    fprintf(stderr, "netplay: no local car, stopped at tick %d\n", sim.frame);
+    return false;
+  }
+  auto waitStart = std::chrono::steady_clock::now();
+  const auto wait = [&](auto &&step) {
+    while (!step()) {
+      if (std::chrono::steady_clock::now() - waitStart > NetTimeout) {
+        fprintf(stderr, "netplay: peer timed out at tick %d\n", sim.frame);
+        return false;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    waitStart = std::chrono::steady_clock::now();
+    return true;
+  };
+  while (sim.frame < ticks) {
+    const Car &local = sim.cars[net.localCar];
+    const CarInputs in = QuantizeInputs(DriveCar(sim.track->line, local));
+    if (!wait([&] { return NetStep(net, sim, in); }))
+      return false;
+  }
+  if (!wait([&] { return NetSync(net, sim, ticks); }))
+    return false;
+  // the peer may still wait for the ack of its last inputs
+  for (int i = 0; i < 10; ++i) {
+    NetSync(net, sim, ticks);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  return true;
+}
+
+} // namespace
+
+int RunHeadless(int argc, char **argv) {
+  // the tick count is optional, the next argument may be another option
+  const char *ticksArg = *GetArg(argc, argv, "--headless");
+  const bool hasTicks = *ticksArg && strncmp(ticksArg, "--", 2) != 0;
+  int ticks = hasTicks ? std::max(1, atoi(ticksArg)) : 100000;
+  const int players =
+      std::clamp(atoi(GetArg(argc, argv, "--players").value_or("4")), 1, 4);
+  const char *seedArg = GetArg(argc, argv, "--seed").value_or("1");
+  uint32_t seed = strtoul(seedArg, nullptr, 10);
+  const int bots =
+      std::clamp(atoi(GetArg(argc, argv, "--bots").value_or("0")), 0, 1000);
+  const char *rateArg = GetArg(argc, argv, "--tick-rate").value_or("60");
+  const int tickRate = std::clamp(atoi(rateArg), 30, 1000);
+  const auto recordPath = GetArg(argc, argv, "--record");
+  std::optional<ReplayReader> replay{};
+  if (const auto path = GetArg(argc, argv, "--replay")) {
+    replay = OpenReplay(*path);
+    if (!replay)
+      return 1;
+    seed = replay->header.trackSeed;
+    ticks = replay->header.tickCount;
+  }
+  std::optional<NetPlay> net{};
+  if (const auto port = GetArg(argc, argv, "--net-port")) {
+    const char *peer = GetArg(argc, argv, "--net-peer").value_or("");
+    const char *playerArg = GetArg(argc, argv, "--net-player").value_or("0");
+    const int player = std::clamp(atoi(playerArg), 0, 1);
+    if (replay || recordPath) {
+      fprintf(stderr, "netplay can't be combined with --replay or --record\n");
+      return 1;
+    }
+    net = OpenNetPlay(atoi(*port), peer, player);
+    if (!net)
+      return 1;
+  }
+  SetTraceLogLevel(LOG_WARNING);
+
+  const Track track = MakeTrack(MakeRandomTrack(seed), nullptr);
+  if (const auto path = GetArg(argc, argv, "--export-minimap")) {
+    JobPool pool;
+    StartJobPool(pool, std::thread::hardware_concurrency());
+    Image img = RasterizeMinimap(track, 1024, pool);
+    StopJobPool(pool);
+    const bool ok = ExportImage(img, *path);
+    UnloadImage(img);
+    return ok ? 0 : 1;
+  }
+
+  SimState sim{.track = &track, .tickRate = tickRate};
+  if (replay) {
+    InitReplayCars(*replay, sim);
+  } else {
+    for (int i = 0; i < (net ? 2 : players); ++i)
+      sim.players[i].enabled = true;
+    InitCars(sim, bots);
+  }
+  std::optional<ReplayWriter> recorder{};
+  if (recordPath)
+    BeginReplay(recorder.emplace(), seed, sim);
+
+  std::vector<CarInputs> inputs(sim.cars.size());
+  const auto t0 = std::chrono::steady_clock::now();
+  if (net && !RunNetPlay(*net, sim, ticks)) {
+    CloseNetPlay(*net);
+    return 1;
+  }
+  for (int t = 0; !net && t < ticks; ++t) {
+    if (replay) {
+      ReadReplayTick(*replay, inputs);
+    } else {
+      for (size_t i = 0; i < sim.cars.size(); ++i)
+        inputs[i] = QuantizeInputs(DriveCar(track.line, sim.cars[i]));
+    }
+    if (recorder)
+      RecordTick(*recorder, sim, inputs);
+    SimStep(sim, inputs);
+  }
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - t0;
+
+  int laps{};
+  for (const Player &p : sim.players)
+    laps += p.laps;
+  printf("%d ticks in %.3fs: %.0f ticks/s, %d laps, best lap %d ticks\n",
+         ticks, elapsed.count(), ticks / elapsed.count(), laps,
+         sim.bestChrono.value_or(0));
+  if (net) {
+    printf("checksum %08x, %d rollbacks, %d ticks resimulated\n",
+           SimChecksum(sim), net->rollbacks, net->resimulated);
+    CloseNetPlay(*net);
+  }
+  if (recorder)
+    SaveReplay(*recorder, *recordPath);
+  if (replay)
+    CloseReplay(*replay);
+  return 0;
+}
@@ -0,0 +1,72 @@
+#include "game.hpp"
+
+// The quads are laid out as DrawText would place them, so the HUD looks the
+// same; the HUD strings are plain ASCII.
+
+void LayoutHudText(HudText &text, const char *str) {
+  const Font font = GetFontDefault();
+  const float scale = float(HudFontSize) / font.baseSize;
+  const float spacing = float(HudFontSize / 10);
+  const float pad = font.glyphPadding;
+  text.quads.clear();
+  float x = 0.0f;
+  for (const char *c = str; *c; ++c) {
+    const int g = GetGlyphIndex(font, *c);
+    const Rectangle &r = font.recs[g];
+    const GlyphInfo &glyph = font.glyphs[g];
+    if (*c != ' ') {
+      const Rectangle src{r.x - pad, r.y - pad, r.width + 2.0f * pad,
+                          r.height + 2.0f * pad};
+      text.quads.push_back({
+          src,
+          Rectangle{x + (glyph.offsetX - pad) * scale,
+                    (glyph.offsetY - pad) * scale, src.width * scale,
+                    src.height * scale},
+      });
+    }
+    x += (glyph.advanceX ? glyph.advanceX : r.width) * scale + spacing;
+  }
+}
+
+// the HUD of every view as one batch of quads from the font texture
+void DrawHud(std::span<const ViewDrawList> lists) {
+  const Texture2D tex = GetFontDefault().texture;
+  int quads = 0;
+  for (const ViewDrawList &list : lists) {
+    for (int i = 0; i < list.hudCount; ++i)
+      quads += list.hud[i].quads.size();
+  }
+  if (quads == 0)
+    return;
+  rlCheckRenderBatchLimit(4 * quads);
+  rlSetTexture(tex.id);
+  rlBegin(RL_QUADS);
+  rlColor4ub(255, 255, 255, 255);
+  rlNormal3f(0.0f, 0.0f, 1.0f);
+  for (const ViewDrawList &list : lists) {
+    for (int i = 0; i < list.hudCount; ++i) {
+      const float ox = list.hudOrigin.x;
+      const float oy = list.hudOrigin.y + i * HudFontSize;
+      for (const auto &[src, dst] : list.hud[i].quads) {
+        const float u0 = src.x / tex.width;
+        const float v0 = src.y / tex.height;
+        const float u1 = (src.x + src.width) / tex.width;
+        const float v1 = (src.y + src.height) / tex.height;
+        const float x0 = ox + dst.x;
+        const float y0 = oy + dst.y;
+        const float x1 = x0 + dst.width;
+        const float y1 = y0 + dst.height;
+        rlTexCoord2f(u0, v0);
+        rlVertex2f(x0, y0);
+        rlTexCoord2f(u0, v1);
+        rlVertex2f(x0, y1);
+        rlTexCoord2f(u1, v1);
+        rlVertex2f(x1, y1);
+        rlTexCoord2f(u1, v0);
+        rlVertex2f(x1, y0);
+      }
+    }
+  }
+  rlEnd();
+  rlSetTexture(0);
+}
@@ -1,16 +1,6 @@
 
 #include "game.hpp"
 
-struct Voxel {
-  int texId{};
-  float x{}, y{}, w{}, h{};
-  int depth{};
-  float lwidth{};
-};
-
-constexpr Voxel vxCar00{0, 7, 10, 16, 7, 6, 32};
-constexpr Voxel vxCar01{1, 12, 6, 7, 19, 5, 32};
-
 template <typename R, typename T> R *AllocCopy(const std::vector<T> &v) {
   void *mem = MemAlloc(v.size() * sizeof(T));
   T *r = (T *)mem;
@@ -65,75 +55,93 @@ Vector2 GetSpline(const std::vector<Vector2> &points, float r, float s) {
   return p + s * n;
 }
 
-Mesh MakeMesh(const std::vector<Vector3> &vertice,
-              const std::vector<Vector2> &uvs,
-              const std::vector<uint16_t> &indice) {
+// attributes left empty in data are not uploaded
+Mesh MakeMesh(const MeshData &data) {
   Mesh mesh{};
-  mesh.vertexCount = vertice.size();
-  mesh.triangleCount = indice.size() / 3;
-  mesh.vertices = AllocCopy<float>(vertice);
-  mesh.texcoords = AllocCopy<float>(uvs);
-  mesh.indices = AllocCopy<uint16_t>(indice);
+  mesh.vertexCount = data.vertice.size();
+  mesh.triangleCount = data.indice.size() / 3;
+  mesh.vertices = AllocCopy<float>(data.vertice);
+  if (!data.uvs.empty())
+    mesh.texcoords = AllocCopy<float>(data.uvs);
+  if (!data.colors.empty())
+    mesh.colors = AllocCopy<unsigned char>(data.colors);
+  mesh.indices = AllocCopy<uint16_t>(data.indice);
   UploadMesh(&mesh, false);
   return mesh;
 }
 
-Model MakeTrackRoad(const std::vector<Vector2> &points, bool loop, int pcount,
-                    Vector2 width, Rectangle *aabb) {
-
-  float minX = points[0].x;
-  float maxX = minX;
-  float minY = points[0].y;
-  float maxY = minY;
-  auto push = [&](Vector2 pos) -> Vector3 {
-    minX = std::min(pos.x, minX);
-    maxX = std::max(pos.x, maxX);
-    minY = std::min(pos.y, minY);
-    maxY = std::max(pos.y, maxY);
-    // return {pos.x, pos.y, 0.0f};
-    return {pos.x, 0.0f, pos.y};
-  };
-
+// The road follows the center line of the track space, cut in pieces of about
+// chunkLength. Rows are kept where the line has turned by maxTurn since the
+// previous row or every maxStep on straights. width holds the offsets of
+// the road edges along the normal. Indices stay 16 bits, the
+// chunks being far below 64k vertices.
+std::vector<RoadChunk> MakeTrackRoad(const TrackSpace &ts, Vector2 width,
+                                     float chunkLength) {
+  const float maxTurn = 0.05f;
+  const float maxStep = 20.0f;
   const float umax = 20.0f;
-
-  std::vector<Vector3> vertice;
-  std::vector<Vector2> uvs;
-  std::vector<uint16_t> indice;
-  const float N = GameScale * width.y;
-  const float P = GameScale * width.x;
-  for (int i = 0; i < pcount; ++i) {
-    const uint16_t p = vertice.size();
-    const float r = i / float(pcount);
-    vertice.push_back(push(GetSpline(points, r, N)));
-    vertice.push_back(push(GetSpline(points, r, P)));
-    const float u = i * umax / pcount;
-    uvs.push_back({u, 0.0f});
-    uvs.push_back({u, 1.0f});
-    const std::array<uint16_t, 6> faces = {
-        uint16_t(p + 0),  uint16_t(p + 2u), uint16_t(p + 1u),
-        uint16_t(p + 2u), uint16_t(p + 3u), uint16_t(p + 1u),
-    };
-    indice.insert(indice.end(), faces.begin(), faces.end());
+  const float N = width.y;
+  const float P = width.x;
+  const int count = ts.pos.size();
+  const int chunkCount = std::max(1, int(ts.length / chunkLength + 0.5f));
+
+  std::vector<RoadChunk> chunks;
+  std::vector<int> rows;
+  for (int c = 0; c < chunkCount; ++c) {
+    const int c0 = c * count / chunkCount;
+    const int c1 = (c + 1) * count / chunkCount;
+    rows = {c0};
+    float turn = 0.0f;
+    for (int i = c0 + 1; i < c1; ++i) {
+      const Vector2 n0 = ts.normal[i - 1];
+      const Vector2 n1 = ts.normal[i];
+      turn += abs(asinf(Clamp(n0.x * n1.y - n0.y * n1.x, -1.0f, 1.0f)));
+      if (turn >= maxTurn || (i - rows.back()) * ts.step >= maxStep) {
+        rows.push_back(i);
+        turn = 0.0f;
+      }
+    }
+    rows.push_back(c1);
+
+    RoadChunk &chunk = chunks.emplace_back();
+    auto &vertice = chunk.mesh.vertice;
+    auto &uvs = chunk.mesh.uvs;
+    auto &indice = chunk.mesh.indice;
+    Vector2 vmin{INFINITY, INFINITY};
+    Vector2 vmax{-INFINITY, -INFINITY};
+    for (const int row : rows) {
+      const Vector2 p = ts.pos[row % count];
+      const Vector2 n = ts.normal[row % count];
+      for (const Vector2 v : {p + N * n, p + P * n}) {
+        vmin = {std::min(vmin.x, v.x), std::min(vmin.y, v.y)};
+        vmax = {std::max(vmax.x, v.x), std::max(vmax.y, v.y)};
+        vertice.push_back({v.x, 0.0f, v.y});
+      }
+      const float u = row * ts.step * umax / ts.length;
+      uvs.push_back({u, 0.0f});
+      uvs.push_back({u, 1.0f});
+      if (vertice.size() == 2)
+        continue;
+      const uint16_t p0 = vertice.size() - 4;
+      const std::array<uint16_t, 6> faces = {
+          uint16_t(p0 + 0),  uint16_t(p0 + 2u), uint16_t(p0 + 1u),
+          uint16_t(p0 + 2u), uint16_t(p0 + 3u), uint16_t(p0 + 1u),
+      };
+      indice.insert(indice.end(), faces.begin(), faces.end());
+    }
+    chunk.aabb = {vmin.x, vmin.y, vmax.x - vmin.x, vmax.y - vmin.y};
   }
-
-  *aabb = {minX, minY, maxX - minX, maxY - minY};
-
-  vertice.push_back(vertice[0]);
-  vertice.push_back(vertice[1]);
-  uvs.push_back({umax, 0.0f});
-  uvs.push_back({umax, 1.0f});
-
-  Mesh mesh = MakeMesh(vertice, uvs, indice);
-  return LoadModelFromMesh(mesh);
+  return chunks;
 }
 
-std::vector<Vector2> MakeRandomTrack() {
+std::vector<Vector2> MakeRandomTrack(uint32_t seed) {
+  Rng rng = MakeRng(seed);
   std::vector<Vector2> track;
   const int count = 17;
   for (int i = 0; i < count; ++i) {
-    const float da = GetRandomValue(-100, 100) / 3000.0f;
+    const float da = rng.Range(-100, 100) / 3000.0f;
     const float a = (i - da) * 2.0f * PI / count;
-    const float r = 350.0f + GetRandomValue(0, 160);
+    const float r = 350.0f + rng.Range(0, 160);
     const float x = 10 * r * cosf(a);
     const float y = 10 * r * sinf(a);
     track.push_back(GameScale * Vector2{x, y});
@@ -141,35 +149,35 @@ std::vector<Vector2> MakeRandomTrack() {
   return track;
 }
 
-Track MakeTrack(Context &ctx, const std::vector<Vector2> &track) {
+Track MakeTrack(const std::vector<Vector2> &track, Model *propModel) {
   Track r{.track = track};
-  Rectangle aabb{};
 
-  {
-    Texture t = LoadTexture("assets/road.png");
-    GenTextureMipmaps(&t);
-    SetTextureFilter(t, TEXTURE_FILTER_BILINEAR);
-
-    {
-      auto &mdl = r.models.emplace_back();
-      mdl = MakeTrackRoad(track, false, 180, {-250.0f, 250.0f}, &aabb);
-      mdl.materials[0].maps[MATERIAL_MAP_ALBEDO].texture = t;
-    }
+  r.space = MakeTrackSpace(track, 2.0f);
+  r.line = MakeRacingLine(r.space, RoadHalfWidth);
+  const float length = r.space.length;
+
+  r.road = MakeTrackRoad(r.space, {-RoadHalfWidth, RoadHalfWidth}, 150.0f);
+  Vector2 vmin{INFINITY, INFINITY};
+  Vector2 vmax{-INFINITY, -INFINITY};
+  for (const RoadChunk &chunk : r.road) {
+    const Rectangle &b = chunk.aabb;
+    vmin = {std::min(vmin.x, b.x), std::min(vmin.y, b.y)};
+    vmax = {std::max(vmax.x, b.x + b.width), std::max(vmax.y, b.y + b.height)};
   }
+  Rectangle aabb{vmin.x, vmin.y, vmax.x - vmin.x, vmax.y - vmin.y};
 
   const auto DropShit = [&](int pcount, float o, float scale) {
     for (int i = 0; i < pcount; ++i) {
-      const float p = i / float(pcount);
-      Vector2 pos{};
-      pos = GetSpline(track, p, o);
-      r.props.push_back({{pos.x, 0, pos.y}, scale, &ctx.mdlTree});
+      const auto [p, n] = SampleTrack(r.space, i * length / pcount);
+      const Vector2 pos = p + o * n;
+      r.props.push_back({{pos.x, 0, pos.y}, scale, propModel});
     }
   };
 
-  for (int i = 0; i < 8; ++i) {
-    const float rt = i / 8.0f;
-    const auto [p, n] = GetSplineAndDir(track, rt);
-    r.checkpoints.push_back({p, 25.0f * n});
+  const int cpCount = 8;
+  for (int i = 0; i < cpCount; ++i) {
+    const auto [p, n] = SampleTrack(r.space, i * length / cpCount);
+    r.checkpoints.push_back(MakeCheckpoint(p, 25.0f * n));
   }
 
   DropShit(45, 40.0f, 3.0f);
@@ -187,80 +195,399 @@ Track MakeTrack(Context &ctx, const std::vector<Vector2> &track) {
     aabb.height = aabb.width;
   }
 
+  std::vector<Rectangle> propBoxes;
+  for (const auto &[pos, scale, mdl] : r.props) {
+    propBoxes.push_back({pos.x, pos.z, 0.0f, 0.0f});
+    r.propRadius = std::max(r.propRadius, 10.0f * scale);
+    r.trunkRadius = std::max(r.trunkRadius, TrunkRadius * scale);
+  }
+  BuildGrid(r.propGrid, aabb, 64.0f, propBoxes);
+
+  std::vector<Rectangle> cpBoxes;
+  for (const auto &cp : r.checkpoints) {
+    const Vector2 a = cp.pos - cp.delta;
+    const Vector2 b = cp.pos + cp.delta;
+    cpBoxes.push_back({std::min(a.x, b.x), std::min(a.y, b.y),
+                       std::abs(b.x - a.x), std::abs(b.y - a.y)});
+  }
+  BuildGrid(r.checkpointGrid, aabb, 64.0f, cpBoxes);
+  r.surface = MakeSurfaceGrid(r.space, RoadHalfWidth, aabb);
+
   r.aabb = aabb;
   return r;
 }
 
-Model ModelVoxels(Vector3 bsize, const std::vector<Texture> &vt,
-                  const Voxel &vx, bool xySwap) {
-  Model mdl{};
+void MakePropBatches(Context &ctx) {
+  const Color tint = BROWN;
+  const auto modulate = [](Color a, Color b) -> Color {
+    return {
+        (unsigned char)(a.r * b.r / 255),
+        (unsigned char)(a.g * b.g / 255),
+        (unsigned char)(a.b * b.b / 255),
+        (unsigned char)(a.a * b.a / 255),
+    };
+  };
+
+  for (auto &batch : ctx.propBatches)
+    for (auto &mat : batch.materials)
+      MemFree(mat.maps);
+  ctx.propBatches.clear();
+  ctx.propBatchIndex.clear();
+
+  for (const auto &prop : ctx.track.props) {
+    const Model *mdl = std::get<2>(prop);
+    auto itb = std::find_if(ctx.propBatches.begin(), ctx.propBatches.end(),
+                            [&](const PropBatch &b) { return b.model == mdl; });
+    if (itb == ctx.propBatches.end()) {
+      PropBatch &batch = ctx.propBatches.emplace_back();
+      batch.model = mdl;
+      for (int i = 0; i < mdl->materialCount; ++i) {
+        const Material &src = mdl->materials[i];
+        Material &mat = batch.materials.emplace_back(src);
+        mat.shader = ctx.shdInstancing;
+        mat.maps = (MaterialMap *)MemAlloc((MATERIAL_MAP_BRDF + 1) *
+                                           sizeof(MaterialMap));
+        std::copy(src.maps, src.maps + MATERIAL_MAP_BRDF + 1, mat.maps);
+        auto &diffuse = mat.maps[MATERIAL_MAP_DIFFUSE];
+        diffuse.color = modulate(diffuse.color, tint);
+      }
+      itb = ctx.propBatches.end() - 1;
+    }
+    ctx.propBatchIndex.push_back(itb - ctx.propBatches.begin());
+  }
+}
 
-  const auto &t = vt[vx.texId];
+// The ground shader used to blend 8 rotated and scaled layers of the noise
+// over the base color, c = mix(c, (1, 0.5, 0.5) * n.rgb, 0.2 * n.a) for
+// each, which folds into c = base * A + B. B goes in rgb and A in alpha of
+// a texture repeating every GroundTile world units; the layer rotations are
+// rounded to integer lattice vectors so that every layer tiles too.
+Image MakeGroundImage(const Image &noise) {
+  const int size = 512;
+  const int layers = 8;
+  const int nw = noise.width;
+  const int nh = noise.height;
+  // the base color alone
+  if (nw == 0 || nh == 0)
+    return GenImageColor(1, 1, {0, 0, 0, 255});
+  std::vector<Vector4> texels(nw * nh);
+  for (int y = 0; y < nh; ++y)
+    for (int x = 0; x < nw; ++x)
+      texels[y * nw + x] = ColorNormalize(GetImageColor(noise, x, y));
+  // repeated bilinear fetch, as the GPU sampled it
+  const auto fetch = [&](Vector2 uv) {
+    const float x = (uv.x - floorf(uv.x)) * nw - 0.5f + nw;
+    const float y = (uv.y - floorf(uv.y)) * nh - 0.5f + nh;
+    const float x0 = floorf(x);
+    const float y0 = floorf(y);
+    const int ix = std::min(int(x0), 2 * nw - 1) - (x0 >= nw ? nw : 0);
+    const int iy = std::min(int(y0), 2 * nh - 1) - (y0 >= nh ? nh : 0);
+    const int ix1 = ix + 1 < nw ? ix + 1 : 0;
+    const Vector4 *r0 = &texels[iy * nw];
+    const Vector4 *r1 = &texels[(iy + 1 < nh ? iy + 1 : 0) * nw];
+    const auto lerp = [](Vector4 a, Vector4 b, float t) {
+      return Vector4{Lerp(a.x, b.x, t), Lerp(a.y, b.y, t), Lerp(a.z, b.z, t),
+                     Lerp(a.w, b.w, t)};
+    };
+    const Vector4 t0 = lerp(r0[ix], r0[ix1], x - x0);
+    const Vector4 t1 = lerp(r1[ix], r1[ix1], x - x0);
+    return lerp(t0, t1, y - y0);
+  };
 
-  std::vector<Vector3> vertice;
-  std::vector<Vector2> uvs;
-  std::vector<uint16_t> indice;
+  // the plane the shader was written for was 20000 units wide
+  const float tiles = 20000.0f / GroundTile;
+  std::array<std::pair<float, float>, layers> lattice{};
+  for (int i = 0; i < layers; ++i) {
+    const float a = i * 3 * 3.14f / (layers - 1);
+    const float k = (15 + 4 * i) / 0.1f / tiles;
+    lattice[i] = {roundf(k * cosf(a)), roundf(k * sinf(a))};
+  }
 
-  const auto push3 = [&](Vector3 p) -> Vector3 { return p; };
-  const auto push2 = [&](Vector2 p) -> Vector2 { return p; };
+  Image img = GenImageColor(size, size, BLANK);
+  Color *pixels = (Color *)img.data;
+  for (int y = 0; y < size; ++y) {
+    for (int x = 0; x < size; ++x) {
+      // 2x2 samples per texel, the finest layer being close to a texel
+      Vector3 sumB{};
+      float sumA = 0.0f;
+      for (int sy = 0; sy < 2; ++sy) {
+        for (int sx = 0; sx < 2; ++sx) {
+          const float u = (x + 0.25f + 0.5f * sx) / size;
+          const float v = (y + 0.25f + 0.5f * sy) / size;
+          Vector3 b{};
+          float a = 1.0f;
+          for (const auto &[p, q] : lattice) {
+            const Vector4 n = fetch({p * u - q * v, q * u + p * v});
+            const float w = 0.2f * n.w;
+            const Vector3 c{n.x, 0.5f * n.y, 0.5f * n.z};
+            b = Vector3Lerp(b, c, w);
+            a *= 1.0f - w;
+          }
+          sumB = sumB + b;
+          sumA += a;
+        }
+      }
+      const Vector3 b = 0.25f * sumB;
+      pixels[y * size + x] = ColorFromNormalized({b.x, b.y, b.z, 0.25f * sumA});
+    }
+  }
+  return img;
+}
 
-  const Vector3 size = bsize;
-  const int tw = t.width;
-  const int th = t.height;
+// The slices of the sheet are stacked as a grid of voxels, x along the car,
+// y up and z across, a voxel being solid where the slice texel is mostly
+// opaque. Faces between a solid voxel and an empty one are merged greedily
+// into rectangles of one color, shaded by direction.
+MeshData MakeVoxelMesh(const Voxel &vx, const Image &sheet) {
+  const Vector3 size = GameScale * Vector3{60, 30, 40};
   const float dh = GameScale * 10.0f;
-  const float v0 = (vx.y) / float(th);
-  const float v1 = (vx.y + vx.h) / float(th);
   const float dx = 0.3f * size.x;
-  const float dy = 0.0f;
-
-  for (int i = 0; i < vx.depth; ++i) {
-    const float u0 = (vx.x + i * vx.lwidth) / float(tw);
-    const float u1 = (vx.x + i * vx.lwidth + vx.w) / float(tw);
-    const uint16_t p = i * 4;
-    vertice.push_back(push3({-size.x - dx, 1.0f + dh * i, size.y - dy}));
-    vertice.push_back(push3({size.x - dx, 1.0f + dh * i, size.y - dy}));
-    vertice.push_back(push3({size.x - dx, 1.0f + dh * i, -size.y - dy}));
-    vertice.push_back(push3({-size.x - dx, 1.0f + dh * i, -size.y - dy}));
-    if (xySwap) {
-      uvs.push_back(push2({u0, v0}));
-      uvs.push_back(push2({u0, v1}));
-      uvs.push_back(push2({u1, v1}));
-      uvs.push_back(push2({u1, v0}));
-    } else {
-      uvs.push_back(push2({u0, v1}));
-      uvs.push_back(push2({u1, v1}));
-      uvs.push_back(push2({u1, v0}));
-      uvs.push_back(push2({u0, v0}));
+  const int w = vx.w;
+  const int h = vx.h;
+  const std::array<int, 3> dims{vx.xySwap ? h : w, vx.depth, vx.xySwap ? w : h};
+  const std::array<float, 3> cell{2.0f * size.x / dims[0], dh,
+                                  2.0f * size.y / dims[2]};
+  const std::array<float, 3> origin{-size.x - dx, 1.0f - 0.5f * dh, -size.y};
+  // +x, +y, +z then -x, -y, -z
+  const std::array<float, 6> shades{0.8f, 1.0f, 0.7f, 0.8f, 0.5f, 0.7f};
+
+  std::vector<Color> grid(dims[0] * dims[1] * dims[2]);
+  for (int y = 0; y < dims[1]; ++y) {
+    for (int z = 0; z < dims[2]; ++z) {
+      for (int x = 0; x < dims[0]; ++x) {
+        const int tx = vx.x + y * vx.lwidth + (vx.xySwap ? w - 1 - z : x);
+        const int ty = vx.y + (vx.xySwap ? x : z);
+        const Color c = GetImageColor(sheet, tx, ty);
+        grid[x + dims[0] * (z + dims[2] * y)] =
+            c.a >= 128 ? Color{c.r, c.g, c.b, 255} : BLANK;
+      }
     }
-    indice.push_back(p + 0);
-    indice.push_back(p + 1);
-    indice.push_back(p + 2);
-    indice.push_back(p + 0);
-    indice.push_back(p + 2);
-    indice.push_back(p + 3);
   }
+  const auto at = [&](std::array<int, 3> p) {
+    for (int a = 0; a < 3; ++a)
+      if (p[a] < 0 || p[a] >= dims[a])
+        return BLANK;
+    return grid[p[0] + dims[0] * (p[2] + dims[2] * p[1])];
+  };
+  const auto same = [](Color a, Color b) {
+    return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+  };
 
-  Mesh mesh = MakeMesh(vertice, uvs, indice);
+  MeshData r;
+  std::vector<Color> mask;
+  for (int d = 0; d < 3; ++d) {
+    const int u = (d + 1) % 3;
+    const int v = (d + 2) % 3;
+    mask.resize(dims[u] * dims[v]);
+    for (const int side : {1, -1}) {
+      const float shade = shades[d + (side < 0 ? 3 : 0)];
+      for (int s = 0; s < dims[d]; ++s) {
+        for (int j = 0; j < dims[v]; ++j) {
+          for (int i = 0; i < dims[u]; ++i) {
+            std::array<int, 3> p{};
+            p[d] = s;
+            p[u] = i;
+            p[v] = j;
+            const Color c = at(p);
+            p[d] += side;
+            mask[i + j * dims[u]] = at(p).a == 0 ? c : BLANK;
+          }
+        }
+
+        for (int j = 0; j < dims[v]; ++j) {
+          for (int i = 0; i < dims[u];) {
+            const Color c = mask[i + j * dims[u]];
+            if (c.a == 0) {
+              ++i;
+              continue;
+            }
+            int wu = 1;
+            while (i + wu < dims[u] && same(mask[i + wu + j * dims[u]], c))
+              ++wu;
+            int wv = 1;
+            for (; j + wv < dims[v]; ++wv) {
+              const Color *row = &mask[i + (j + wv) * dims[u]];
+              if (!std::all_of(row, row + wu,
+                               [&](Color m) { return same(m, c); }))
+                break;
+            }
+            for (int b = 0; b < wv; ++b)
+              std::fill_n(&mask[i + (j + b) * dims[u]], wu, BLANK);
+
+            std::array<float, 3> base{};
+            base[d] = s + (side > 0 ? 1 : 0);
+            base[u] = i;
+            base[v] = j;
+            std::array<std::array<float, 3>, 4> quad{base, base, base, base};
+            quad[1][u] += wu;
+            quad[2][u] += wu;
+            quad[2][v] += wv;
+            quad[3][v] += wv;
+            if (side < 0)
+              std::swap(quad[1], quad[3]);
+            const uint16_t p0 = r.vertice.size();
+            for (const auto &q : quad) {
+              r.vertice.push_back({
+                  origin[0] + q[0] * cell[0],
+                  origin[1] + q[1] * cell[1],
+                  origin[2] + q[2] * cell[2],
+              });
+              r.colors.push_back({
+                  (unsigned char)(c.r * shade),
+                  (unsigned char)(c.g * shade),
+                  (unsigned char)(c.b * shade),
+                  255,
+              });
+            }
+            for (const int k : {0, 1, 2, 0, 2, 3})
+              r.indice.push_back(p0 + k);
+            i += wu;
+          }
+        }
+      }
+    }
+  }
+  return r;
+}
+
+// assets from their source files, when there is no baked pack: images are
+// decoded and mipmapped on the tasks, car meshes built from their sheets
+std::vector<LoadTask> LooseAssetTasks() {
+  std::vector<LoadTask> tasks;
+  for (int t = 0; t < CarTextureCount; ++t) {
+    tasks.push_back([t](Loader &loader) {
+      char path[64]{};
+      snprintf(path, sizeof(path), "assets/car%02d.png", t);
+      const Image img = LoadImage(path);
+      for (size_t i = 0; i < CarVoxels.size(); ++i) {
+        if (CarVoxels[i].texId != t)
+          continue;
+        const MeshData mesh = MakeVoxelMesh(CarVoxels[i], img);
+        QueueUpload(loader, [i, mesh](Context &ctx) {
+          ctx.mdlCars[i] = LoadModelFromMesh(MakeMesh(mesh));
+        });
+      }
+      UnloadImage(img);
+    });
+  }
+
+  const auto mipmapped = [](const char *path, Texture Context::*dst) {
+    return [path, dst](Loader &loader) {
+      Image img = LoadImage(path);
+      ImageMipmaps(&img);
+      QueueUpload(loader, [img, dst](Context &ctx) {
+        ctx.*dst = LoadTextureFromImage(img);
+        SetTextureFilter(ctx.*dst, TEXTURE_FILTER_BILINEAR);
+        UnloadImage(img);
+      });
+    };
+  };
+  tasks.push_back([](Loader &loader) {
+    const Image noise = LoadImage("assets/noise00.png");
+    Image img = MakeGroundImage(noise);
+    UnloadImage(noise);
+    ImageMipmaps(&img);
+    QueueUpload(loader, [img](Context &ctx) {
+      ctx.groundTex = LoadTextureFromImage(img);
+      SetTextureFilter(ctx.groundTex, TEXTURE_FILTER_BILINEAR);
+      UnloadImage(img);
+    });
+  });
+  tasks.push_back(mipmapped("assets/road.png", &Context::roadTex));
+
+  // the gltf importer uploads the meshes itself
+  tasks.push_back([](Loader &loader) {
+    QueueUpload(loader, [](Context &ctx) {
+      ctx.mdlTree = LoadModel("assets/tree00.gltf");
+    });
+  });
+  return tasks;
+}
 
-  mdl = LoadModelFromMesh(mesh);
-  mdl.materials[0].maps[MATERIAL_MAP_ALBEDO].texture = t;
-  return mdl;
+// the track and its minimap are built on the task, the road chunks are
+// uploaded into loader.track until FinishLoad installs it
+LoadTask TrackTask(uint32_t seed, Model *propModel) {
+  return [seed, propModel](Loader &loader) {
+    Track track = MakeTrack(MakeRandomTrack(seed), propModel);
+    // the loader pool is busy running this task
+    JobPool serial;
+    const Image img = RasterizeMinimap(track, 1024, serial);
+    const size_t chunkCount = track.road.size();
+    {
+      std::lock_guard lock(loader.mutex);
+      loader.track = std::move(track);
+    }
+    for (size_t i = 0; i < chunkCount; ++i) {
+      QueueUpload(loader, [i](Context &ctx) {
+        RoadChunk &chunk = ctx.loader.track->road[i];
+        chunk.model = LoadModelFromMesh(MakeMesh(chunk.mesh));
+      });
+    }
+    QueueUpload(loader, [img](Context &ctx) {
+      if (ctx.trackTex.id != 0)
+        UnloadTexture(ctx.trackTex);
+      ctx.trackTex = LoadTextureFromImage(img);
+      UnloadImage(img);
+    });
+  };
 }
 
-void InitCars(Context &ctx) {
-  ctx.cars.clear();
+// on the main thread once everything is uploaded
+void FinishLoad(Context &ctx) {
+  if (ctx.loader.track) {
+    for (RoadChunk &chunk : ctx.track.road)
+      UnloadModel(chunk.model);
+    ctx.track = std::move(*ctx.loader.track);
+    ctx.loader.track.reset();
+    for (RoadChunk &chunk : ctx.track.road)
+      chunk.model.materials[0].maps[MATERIAL_MAP_ALBEDO].texture = ctx.roadTex;
+    ctx.sim.track = &ctx.track;
+    ctx.checkPointsChrono.assign(ctx.track.checkpoints.size(), 0);
+    MakePropBatches(ctx);
+  }
+  ctx.mdlGround.materials[0].maps[MATERIAL_MAP_ALBEDO].texture = ctx.groundTex;
+
+  ctx.state = ctx.loader.next;
+  if (ctx.state == State::Race && ctx.replay)
+    InitReplayCars(*ctx.replay, ctx.sim);
+  if (ctx.state == State::Race && ctx.net) {
+    // the local player on the first gamepad, the remote one on none
+    ctx.sim.players = {};
+    for (const int i : {ctx.net->localPlayer, ctx.net->remotePlayer})
+      ctx.sim.players[i].enabled = true;
+    ctx.sim.players[ctx.net->remotePlayer].gamepad = -1;
+    InitCars(ctx.sim, ctx.botCount);
+    if (!StartNetPlay(*ctx.net, ctx.sim)) {
+      CloseNetPlay(*ctx.net);
+      ctx.net.reset();
+    }
+  }
+}
 
-  const auto [p, n] = GetSplineAndDir(ctx.track.track, 0.95f);
-  for (size_t i = 0; i < ctx.players.size(); ++i) {
-    const auto &player = ctx.players[i];
-    if (player.enabled) {
-      Car &car = ctx.cars.emplace_back();
+// a grid of rows of 4 behind the start line, the players in front
+void InitCars(SimState &sim, int bots) {
+  sim.cars.clear();
+
+  const auto &space = sim.track->space;
+  const auto place = [&](Car &car) {
+    const int slot = sim.cars.size() - 1;
+    const float s = 0.95f * space.length - 12.0f * (slot / 4);
+    const auto [p, n] = SampleTrack(space, s);
+    car.data.pos = p + 10.0f * (slot % 4 - 1.5f) * n;
+    car.data.dir = atan2f(-n.x, n.y);
+    car.lastDir = car.data.dir;
+    car.trackPos = ProjectOnTrack(space, car.data.pos);
+    car.model = slot % 2;
+  };
+  for (size_t i = 0; i < sim.players.size(); ++i) {
+    if (sim.players[i].enabled) {
+      Car &car = sim.cars.emplace_back();
       car.playerIndex = int(i);
-      car.data.pos = p;
-      car.model = i % 2;
-      car.data.dir = atan2f(-n.x, n.y);
+      place(car);
     }
   }
+  for (int i = 0; i < bots; ++i)
+    place(sim.cars.emplace_back());
 }
 
 void Init(Context &ctx, int argc, char **argv) {
@@ -270,75 +597,78 @@ void Init(Context &ctx, int argc, char **argv) {
   InitWindow(ctx.W, ctx.H, "main");
   // SetWindowState(FLAG_FULLSCREEN_MODE);
   SetWindowState(FLAG_VSYNC_HINT);
-  SetTargetFPS(60);
+  ctx.targetFps = atoi(GetArg(argc, argv, "--fps").value_or("60"));
+  SetTargetFPS(ctx.targetFps);
   DisableCursor();
 
+  const int cores = std::thread::hardware_concurrency();
+  StartJobPool(ctx.jobs, std::clamp(cores - 1, 0, 7));
+
   ctx.rts = {
       LoadRenderTexture(8, 8),
       LoadRenderTexture(8, 8),
       LoadRenderTexture(8, 8),
       LoadRenderTexture(8, 8),
   };
-  ctx.voxelTex = {
-      LoadTexture("assets/car00.png"),
-      LoadTexture("assets/car01.png"),
-  };
-  ctx.noiseTex = LoadTexture("assets/noise00.png");
-  GenTextureMipmaps(&ctx.noiseTex);
-  SetTextureFilter(ctx.noiseTex, TEXTURE_FILTER_BILINEAR);
-
-  ctx.mdlTree = LoadModel("assets/tree00.gltf");
-
-  ctx.track = MakeTrack(ctx, MakeRandomTrack());
-  ctx.checkPointsChrono.resize(ctx.track.checkpoints.size());
-
-  ctx.shdGround = LoadShader("assets/shaders/ground.vs.glsl",
-                             "assets/shaders/ground.fs.glsl");
-  ctx.shdInstancing = LoadShader("assets/shaders/instancing.vs.glsl", nullptr);
-  ctx.shdInstancing.locs[SHADER_LOC_MATRIX_MODEL] =
-      GetShaderLocationAttrib(ctx.shdInstancing, "instanceTransform");
-
-  ctx.mdlParticle = LoadModelFromMesh(GenMeshSphere(1, 8, 8));
-  ctx.mdlParticle.materials[0].shader = ctx.shdInstancing;
-
-  const Vector3 carSize = GameScale * Vector3{60, 30, 40};
-  ctx.mdlCars = {
-      ModelVoxels(carSize, ctx.voxelTex, vxCar00, false),
-      ModelVoxels(carSize, ctx.voxelTex, vxCar01, true),
-  };
+  ctx.recordPath = GetArg(argc, argv, "--record");
+  if (const auto path = GetArg(argc, argv, "--replay"))
+    ctx.replay = OpenReplay(*path);
+  if (ctx.replay)
+    ctx.trackSeed = ctx.replay->header.trackSeed;
+  else if (const auto seed = GetArg(argc, argv, "--seed"))
+    ctx.trackSeed = strtoul(*seed, nullptr, 10);
+  else
+    ctx.trackSeed = GetRandomValue(1, INT32_MAX);
+  ctx.sim.profiler = &ctx.profiler;
+  const char *rateArg = GetArg(argc, argv, "--tick-rate").value_or("60");
+  ctx.sim.tickRate = std::clamp(atoi(rateArg), 30, 1000);
+  ctx.botCount = std::clamp(atoi(GetArg(argc, argv, "--bots").value_or("0")),
+                            0, 1000);
+  // both peers need the same --seed and --bots
+  if (const auto port = GetArg(argc, argv, "--net-port"); port && !ctx.replay) {
+    const char *peer = GetArg(argc, argv, "--net-peer").value_or("");
+    const char *playerArg = GetArg(argc, argv, "--net-player").value_or("0");
+    const int player = std::clamp(atoi(playerArg), 0, 1);
+    ctx.net = OpenNetPlay(atoi(*port), peer, player);
+    ctx.recordPath.reset();
+  }
 
-  ctx.mdlGround = LoadModelFromMesh(GenMeshPlane(20000, 20000, 32, 32));
-  ctx.mdlGround.materials[0].shader = ctx.shdGround;
-  ctx.mdlGround.materials[0].maps[MATERIAL_MAP_ALBEDO].texture = ctx.noiseTex;
-  ctx.mdlGround.materials[0].maps[MATERIAL_MAP_ALBEDO].color = WHITE;
-
-  {
-    const auto aabb = ctx.track.aabb;
-    const int tsz = 1024;
-    TraceLog(LOG_INFO, "aabb: %.01f %.01f %.01f %.01f", aabb.x, aabb.y,
-             aabb.width, aabb.height);
-    RenderTexture t = LoadRenderTexture(tsz, tsz);
-    BeginTextureMode(t);
-    ClearBackground({0, 0, 0, 64});
-    {
-      const float sz = aabb.width;
-      const float x = aabb.x + 0.5f * sz;
-      const float y = aabb.y + 0.5f * sz;
-      const float scale = sz;
-      const Camera3D cam{
-          {x, 10, y}, {x, -10, y}, {0, 0, -1}, scale, CAMERA_ORTHOGRAPHIC,
-      };
-      BeginMode3D(cam);
-      for (const auto &mdl : ctx.track.models)
-        DrawModel(mdl, {}, 1, WHITE);
-      EndMode2D();
-    }
-    EndTextureMode();
-    Image img = LoadImageFromTexture(t.texture);
-    UnloadRenderTexture(t);
-    ImageFlipVertical(&img);
-    TraceLog(LOG_INFO, "image: %dx%d", img.width, img.height);
-    ctx.trackTex = LoadTextureFromImage(img);
-    UnloadImage(img);
+  StartLoader(ctx.loader, std::clamp(cores / 2, 1, 4));
+  ctx.mdlCars.resize(CarVoxels.size());
+
+  std::vector<LoadTask> tasks;
+  const char *pack = GetArg(argc, argv, "--pack").value_or("assets/pack.bin");
+  if (FileExists(pack)) {
+    tasks.push_back([pack](Loader &loader) {
+      if (LoadPack(loader, pack))
+        return;
+      for (const LoadTask &task : LooseAssetTasks())
+        task(loader);
+    });
+  } else {
+    tasks = LooseAssetTasks();
   }
+  tasks.push_back(TrackTask(ctx.trackSeed, &ctx.mdlTree));
+  tasks.push_back([](Loader &loader) {
+    QueueUpload(loader, [](Context &ctx) {
+      ctx.shdGround = LoadShader("assets/shaders/ground.vs.glsl",
+                                 "assets/shaders/ground.fs.glsl");
+      SetShaderValue(ctx.shdGround, GetShaderLocation(ctx.shdGround, "tile"),
+                     &GroundTile, SHADER_UNIFORM_FLOAT);
+      ctx.shdInstancing =
+          LoadShader("assets/shaders/instancing.vs.glsl", nullptr);
+      ctx.shdInstancing.locs[SHADER_LOC_MATRIX_MODEL] =
+          GetShaderLocationAttrib(ctx.shdInstancing, "instanceTransform");
+
+      ctx.mdlParticle = LoadModelFromMesh(GenMeshSphere(1, 8, 8));
+      ctx.mdlParticle.materials[0].shader = ctx.shdInstancing;
+
+      // a unit quad, stretched over the ground each view sees
+      ctx.mdlGround = LoadModelFromMesh(GenMeshPlane(1, 1, 1, 1));
+      ctx.mdlGround.materials[0].shader = ctx.shdGround;
+      ctx.mdlGround.materials[0].maps[MATERIAL_MAP_ALBEDO].color = WHITE;
+    });
+  });
+  BeginLoad(ctx, std::move(tasks),
+            ctx.replay || ctx.net ? State::Race : State::Main);
 }
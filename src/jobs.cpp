@@ -0,0 +1,77 @@
+#include "game.hpp"
+
+namespace {
+
+// take items of the current job until there are none left
+void RunItems(JobPool &pool, const std::function<void(size_t)> &fn,
+              size_t count) {
+  for (size_t i = pool.next++; i < count; i = pool.next++) {
+    fn(i);
+    if (++pool.finished == count) {
+      std::lock_guard lock(pool.mutex);
+      pool.idle.notify_all();
+    }
+  }
+}
+
+void WorkerLoop(JobPool &pool) {
+  uint64_t seen{};
+  std::unique_lock lock(pool.mutex);
+  for (;;) {
+    pool.wake.wait(lock,
+                   [&]() { return pool.quit || pool.generation != seen; });
+    if (pool.quit)
+      return;
+    seen = pool.generation;
+    const auto *fn = pool.job;
+    const size_t count = pool.count;
+    pool.busy += 1;
+    lock.unlock();
+    RunItems(pool, *fn, count);
+    lock.lock();
+    if (--pool.busy == 0)
+      pool.idle.notify_all();
+  }
+}
+
+} // namespace
+
+void StartJobPool(JobPool &pool, int threads) {
+  for (int i = 0; i < threads; ++i)
+    pool.workers.emplace_back(WorkerLoop, std::ref(pool));
+}
+
+void StopJobPool(JobPool &pool) {
+  {
+    std::lock_guard lock(pool.mutex);
+    pool.quit = true;
+  }
+  pool.wake.notify_all();
+  for (auto &worker : pool.workers)
+    worker.join();
+  pool.workers.clear();
+}
+
+// runs fn(0) .. fn(count - 1) across the pool and returns once all are done
+void ParallelFor(JobPool &pool, size_t count,
+                 const std::function<void(size_t)> &fn) {
+  if (pool.workers.empty() || count <= 1) {
+    for (size_t i = 0; i < count; ++i)
+      fn(i);
+    return;
+  }
+  {
+    // late workers of the previous job must be gone before it is replaced
+    std::unique_lock lock(pool.mutex);
+    pool.idle.wait(lock, [&]() { return pool.busy == 0; });
+    pool.job = &fn;
+    pool.count = count;
+    pool.next = 0;
+    pool.finished = 0;
+    pool.generation += 1;
+  }
+  pool.wake.notify_all();
+  RunItems(pool, fn, count);
+  std::unique_lock lock(pool.mutex);
+  pool.idle.wait(lock, [&]() { return pool.finished == count; });
+}
@@ -0,0 +1,66 @@
+#include "game.hpp"
+
+void StartLoader(Loader &loader, int threads) {
+  StartJobPool(loader.pool, threads);
+}
+
+void StopLoader(Loader &loader) {
+  if (loader.driver.joinable())
+    loader.driver.join();
+  StopJobPool(loader.pool);
+}
+
+// callable from the loader tasks, items run in the order they are queued
+void QueueUpload(Loader &loader, UploadItem item) {
+  std::lock_guard lock(loader.mutex);
+  loader.uploads.push_back(std::move(item));
+  loader.uploadsQueued += 1;
+}
+
+void BeginLoad(Context &ctx, std::vector<LoadTask> tasks, State next) {
+  Loader &loader = ctx.loader;
+  if (loader.driver.joinable())
+    loader.driver.join();
+  loader.taskCount = tasks.size();
+  loader.tasksDone = 0;
+  loader.uploadsQueued = 0;
+  loader.uploadsDone = 0;
+  loader.cpuDone = false;
+  loader.next = next;
+  ctx.state = State::Loading;
+  loader.driver = std::thread([&loader, tasks = std::move(tasks)]() {
+    ParallelFor(loader.pool, tasks.size(), [&](size_t i) {
+      tasks[i](loader);
+      loader.tasksDone += 1;
+    });
+    loader.cpuDone = true;
+  });
+}
+
+// runs queued uploads for about budget seconds, at least one, and returns
+// true once the tasks are done and nothing is left to upload
+bool PumpLoader(Context &ctx, double budget) {
+  Loader &loader = ctx.loader;
+  const double start = GetTime();
+  for (;;) {
+    const bool cpuDone = loader.cpuDone;
+    UploadItem item;
+    {
+      std::lock_guard lock(loader.mutex);
+      if (loader.uploads.empty())
+        return cpuDone;
+      item = std::move(loader.uploads.front());
+      loader.uploads.pop_front();
+    }
+    item(ctx);
+    loader.uploadsDone += 1;
+    if (GetTime() - start >= budget)
+      return false;
+  }
+}
+
+float LoadProgress(const Loader &loader) {
+  const int total = loader.taskCount + loader.uploadsQueued;
+  const int done = loader.tasksDone + loader.uploadsDone;
+  return total ? float(done) / total : 1.0f;
+}
@@ -1,13 +1,40 @@
 
 #include "game.hpp"
 
-void Release(Context &ctx) {}
+void Release(Context &ctx) {
+  if (ctx.recorder)
+    SaveReplay(*ctx.recorder, *ctx.recordPath);
+  if (ctx.replay)
+    CloseReplay(*ctx.replay);
+  if (ctx.net)
+    CloseNetPlay(*ctx.net);
+  StopLoader(ctx.loader);
+  StopJobPool(ctx.jobs);
+}
 
 int main(int argc, char **argv) {
+  if (GetArg(argc, argv, "--headless"))
+    return RunHeadless(argc, argv);
+  if (const auto path = GetArg(argc, argv, "--bake"))
+    return BakePack(**path ? *path : "assets/pack.bin") ? 0 : 1;
   Context ctx;
   Init(ctx, argc, argv);
-  while (Update(ctx))
+  while (true) {
+    BeginProfileFrame(ctx.profiler);
+    ResetArena(ctx.frameArena);
+    const int64_t allocations = HeapAllocations();
+    if (!Update(ctx))
+      break;
     Render(ctx);
+    ctx.frameAllocations = HeapAllocations() - allocations;
+#ifdef DEBUG
+    // past the first second of a race, every buffer should have its size
+    if (ctx.state == State::Race && ctx.sim.frame > ctx.sim.tickRate &&
+        ctx.frameAllocations > 0)
+      TraceLog(LOG_WARNING, "%d heap allocations in a race frame",
+               int(ctx.frameAllocations));
+#endif
+  }
   Release(ctx);
   return 0;
 }
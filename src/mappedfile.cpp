@@ -0,0 +1,63 @@
+#include "game.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOGDI
+#define NOUSER
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// read only mapping of a whole file, pages are loaded on first access
+std::optional<MappedFile> MapFile(const char *path) {
+#ifdef _WIN32
+  HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    return {};
+  LARGE_INTEGER size{};
+  GetFileSizeEx(file, &size);
+  HANDLE mapping =
+      CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  CloseHandle(file);
+  if (mapping == nullptr)
+    return {};
+  const void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (data == nullptr) {
+    CloseHandle(mapping);
+    return {};
+  }
+  return MappedFile{(const uint8_t *)data, size_t(size.QuadPart),
+                    intptr_t(mapping)};
+#else
+  const int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return {};
+  struct stat st {};
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    close(fd);
+    return {};
+  }
+  void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED)
+    return {};
+  return MappedFile{(const uint8_t *)data, size_t(st.st_size), 0};
+#endif
+}
+
+void UnmapFile(MappedFile &file) {
+  if (file.data == nullptr)
+    return;
+#ifdef _WIN32
+  UnmapViewOfFile(file.data);
+  CloseHandle(HANDLE(file.handle));
+#else
+  munmap((void *)file.data, file.size);
+#endif
+  file = {};
+}
@@ -0,0 +1,94 @@
+#include "game.hpp"
+
+// The road is the union of the quads between consecutive track space rows.
+// Pixel (x, y) covers world (aabb.x + x * w / size, aabb.y + y * h / size)
+// and is filled when its center falls inside a quad. Rows are split in bands
+// rasterized in parallel, each band only walking the quads that reach it.
+
+namespace {
+
+constexpr int BandRows = 32;
+constexpr Color RoadColor{200, 200, 200, 255};
+constexpr Color BackColor{0, 0, 0, 64};
+
+struct Quad {
+  std::array<Vector2, 4> v{};
+  int row0{};
+  int row1{};
+};
+
+void FillSpan(Image &img, int y, float x0, float x1) {
+  const int px0 = std::max(0, int(ceilf(x0 - 0.5f)));
+  const int px1 = std::min(img.width - 1, int(floorf(x1 - 0.5f)));
+  Color *row = (Color *)img.data + size_t(y) * img.width;
+  for (int x = px0; x <= px1; ++x)
+    row[x] = RoadColor;
+}
+
+void RasterizeBand(Image &img, const std::vector<Quad> &quads, int y0,
+                   int y1) {
+  for (const Quad &q : quads) {
+    if (q.row1 < y0 || q.row0 >= y1)
+      continue;
+    for (int y = std::max(y0, q.row0); y <= std::min(y1 - 1, q.row1); ++y) {
+      const float cy = y + 0.5f;
+      float x0 = INFINITY;
+      float x1 = -INFINITY;
+      for (size_t e = 0; e < q.v.size(); ++e) {
+        const Vector2 a = q.v[e];
+        const Vector2 b = q.v[(e + 1) % q.v.size()];
+        if ((a.y <= cy) == (b.y <= cy))
+          continue;
+        const float x = a.x + (cy - a.y) * (b.x - a.x) / (b.y - a.y);
+        x0 = std::min(x0, x);
+        x1 = std::max(x1, x);
+      }
+      if (x0 <= x1)
+        FillSpan(img, y, x0, x1);
+    }
+  }
+}
+
+} // namespace
+
+// needs no window, the result is ready for LoadTextureFromImage or ExportImage
+Image RasterizeMinimap(const Track &track, int size, JobPool &pool) {
+  Image img = GenImageColor(size, size, BackColor);
+  const TrackSpace &ts = track.space;
+  const Rectangle &bb = track.aabb;
+  const float half = RoadHalfWidth;
+  const auto toPixels = [&](Vector2 p) {
+    return Vector2{
+        (p.x - bb.x) * size / bb.width,
+        (p.y - bb.y) * size / bb.height,
+    };
+  };
+
+  const size_t count = ts.pos.size();
+  std::vector<Quad> quads(count);
+  for (size_t i = 0; i < count; ++i) {
+    const size_t j = (i + 1) % count;
+    Quad &q = quads[i];
+    q.v = {
+        toPixels(ts.pos[i] + half * ts.normal[i]),
+        toPixels(ts.pos[j] + half * ts.normal[j]),
+        toPixels(ts.pos[j] - half * ts.normal[j]),
+        toPixels(ts.pos[i] - half * ts.normal[i]),
+    };
+    float ymin = INFINITY;
+    float ymax = -INFINITY;
+    for (const Vector2 &v : q.v) {
+      ymin = std::min(ymin, v.y);
+      ymax = std::max(ymax, v.y);
+    }
+    q.row0 = int(floorf(ymin));
+    q.row1 = int(ceilf(ymax));
+  }
+
+  const int bands = (size + BandRows - 1) / BandRows;
+  ParallelFor(pool, bands, [&](size_t b) {
+    const int y0 = b * BandRows;
+    RasterizeBand(img, quads, y0, std::min(size, y0 + BandRows));
+  });
+  return img;
+}
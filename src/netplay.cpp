@@ -0,0 +1,248 @@
+#include "game.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOGDI
+#define NOUSER
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+// Packet: NetPacket, then count inputs of 2 bytes (wheel, flags) for the
+// local ticks [first, first + count). Every packet repeats all the inputs the
+// peer has not acknowledged, so a lost one is covered by the next. The
+// stall rule bounds them: neither peer gets more than NetMaxRollback ticks
+// ahead of the inputs it has from the other.
+
+namespace {
+
+constexpr uint32_t NetMagic = 0x54454e4d; // "MNET"
+
+struct NetPacket {
+  uint32_t magic{NetMagic};
+  int32_t ack{};
+  int32_t first{};
+  int32_t count{};
+};
+
+constexpr int MaxPacketInputs = 2 * NetMaxRollback + 2;
+static_assert(MaxPacketInputs < NetHistory);
+static_assert(sizeof(sockaddr_in) == sizeof(NetPlay::peer));
+
+uint8_t InputFlags(const CarInputs &in) {
+  return (in.cthrust > 0.5f ? 1 : 0) | (in.brake > 0.5f ? 2 : 0) |
+         (in.handbrake > 0.5f ? 4 : 0);
+}
+
+CarInputs MakeInputs(int8_t wheel, uint8_t flags) {
+  return {
+      .cwheel = wheel / 127.0f,
+      .cthrust = (flags & 1) ? 1.0f : 0.0f,
+      .brake = (flags & 2) ? 1.0f : 0.0f,
+      .handbrake = (flags & 4) ? 1.0f : 0.0f,
+  };
+}
+
+bool SameInputs(const CarInputs &a, const CarInputs &b) {
+  return a.cwheel == b.cwheel && InputFlags(a) == InputFlags(b);
+}
+
+void CloseSocket(intptr_t s) {
+#ifdef _WIN32
+  closesocket(SOCKET(s));
+#else
+  close(int(s));
+#endif
+}
+
+void Send(const NetPlay &net, int localTicks) {
+  const int first = std::max(net.remoteAck, localTicks - MaxPacketInputs);
+  const NetPacket header{
+      .ack = net.remoteTicks,
+      .first = first,
+      .count = localTicks - first,
+  };
+  std::array<uint8_t, sizeof(NetPacket) + 2 * MaxPacketInputs> buf{};
+  memcpy(buf.data(), &header, sizeof(header));
+  uint8_t *p = buf.data() + sizeof(header);
+  for (int t = first; t < localTicks; ++t) {
+    const CarInputs &in = net.inputs[t % NetHistory][0];
+    *p++ = uint8_t(int8_t(roundf(in.cwheel * 127.0f)));
+    *p++ = InputFlags(in);
+  }
+  sendto(net.socket, (const char *)buf.data(), int(p - buf.data()), 0,
+         (const sockaddr *)net.peer.data(), sizeof(sockaddr_in));
+}
+
+// reads every pending packet; a remote input arriving for a tick simulated
+// with another prediction marks the rollback
+void Receive(NetPlay &net, int frame) {
+  std::array<uint8_t, 1024> buf{};
+  for (;;) {
+    const int size =
+        recvfrom(net.socket, (char *)buf.data(), int(buf.size()), 0,
+                 nullptr, nullptr);
+    if (size < 0)
+      return;
+    NetPacket header{};
+    if (size >= int(sizeof(header)))
+      memcpy(&header, buf.data(), sizeof(header));
+    if (header.magic != NetMagic || header.count < 0 ||
+        size < int(sizeof(NetPacket)) + 2 * header.count)
+      continue;
+    net.remoteAck = std::max(net.remoteAck, header.ack);
+    const uint8_t *p = buf.data() + sizeof(header);
+    for (int i = 0; i < header.count; ++i, p += 2) {
+      const int t = header.first + i;
+      // older ones are known, newer ones wait for the gap to be resent
+      if (t != net.remoteTicks || t >= frame + NetHistory - MaxPacketInputs)
+        continue;
+      const CarInputs in = MakeInputs(int8_t(p[0]), p[1]);
+      CarInputs &used = net.inputs[t % NetHistory][1];
+      if (t < frame && !SameInputs(used, in))
+        net.rollbackFrom = std::min(t, net.rollbackFrom.value_or(t));
+      used = in;
+      net.remoteTicks += 1;
+    }
+  }
+}
+
+// runs tick t from the inputs history, the unknown remote ones repeating
+// the last received
+void RunTick(NetPlay &net, SimState &sim) {
+  const int t = sim.frame;
+  auto &inputs = net.inputs[t % NetHistory];
+  if (t >= net.remoteTicks)
+    inputs[1] = net.remoteTicks > 0
+                    ? net.inputs[(net.remoteTicks - 1) % NetHistory][1]
+                    : CarInputs{};
+  SaveSnapshot(sim, net.snapshots[t % net.snapshots.size()]);
+  net.tickInputs.assign(sim.cars.size(), CarInputs{});
+  for (size_t i = 0; i < sim.cars.size(); ++i) {
+    const auto &player = sim.cars[i].playerIndex;
+    if (player == net.localPlayer)
+      net.tickInputs[i] = inputs[0];
+    else if (player == net.remotePlayer)
+      net.tickInputs[i] = inputs[1];
+  }
+  DriveBots(sim, net.tickInputs);
+  SimStep(sim, net.tickInputs);
+}
+
+void Rollback(NetPlay &net, SimState &sim) {
+  if (!net.rollbackFrom)
+    return;
+  const int frame = sim.frame;
+  RestoreSnapshot(sim,
+                  net.snapshots[*net.rollbackFrom % net.snapshots.size()]);
+  net.rollbacks += 1;
+  net.lastRollback = frame - *net.rollbackFrom;
+  net.resimulated += net.lastRollback;
+  net.rollbackFrom.reset();
+  while (sim.frame < frame)
+    RunTick(net, sim);
+}
+
+} // namespace
+
+// binds port on every interface, peer is "ipv4:port"; player is the local
+// one, the peer drives the other of players 0 and 1
+std::optional<NetPlay> OpenNetPlay(int port, const char *peer, int player) {
+#ifdef _WIN32
+  WSADATA wsa{};
+  if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0)
+    return {};
+#endif
+  char host[64]{};
+  int peerPort = 0;
+  if (sscanf(peer, "%63[^:]:%d", host, &peerPort) != 2) {
+    TraceLog(LOG_WARNING, "invalid peer %s", peer);
+    return {};
+  }
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(uint16_t(peerPort));
+  if (inet_pton(AF_INET, host, &addr.sin_addr) != 1) {
+    TraceLog(LOG_WARNING, "invalid peer %s", peer);
+    return {};
+  }
+
+  const auto s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  sockaddr_in local{};
+  local.sin_family = AF_INET;
+  local.sin_port = htons(uint16_t(port));
+  local.sin_addr.s_addr = htonl(INADDR_ANY);
+  if (bind(s, (const sockaddr *)&local, sizeof(local)) != 0) {
+    TraceLog(LOG_WARNING, "can't bind port %d", port);
+    CloseSocket(intptr_t(s));
+    return {};
+  }
+#ifdef _WIN32
+  u_long nonBlocking = 1;
+  ioctlsocket(s, FIONBIO, &nonBlocking);
+#else
+  fcntl(s, F_SETFL, fcntl(s, F_GETFL) | O_NONBLOCK);
+#endif
+
+  NetPlay net{
+      .socket = intptr_t(s),
+      .localPlayer = player,
+      .remotePlayer = 1 - player,
+  };
+  memcpy(net.peer.data(), &addr, sizeof(addr));
+  net.snapshots.resize(NetMaxRollback + 1);
+  TraceLog(LOG_INFO, "netplay: port %d, peer %s, player %d", port, peer,
+           player);
+  return net;
+}
+
+void CloseNetPlay(NetPlay &net) {
+  CloseSocket(net.socket);
+  net.socket = -1;
+#ifdef _WIN32
+  WSACleanup();
+#endif
+}
+
+// once the cars are placed, false when the local player has none
+bool StartNetPlay(NetPlay &net, const SimState &sim) {
+  const auto car =
+      std::ranges::find(sim.cars, net.localPlayer,
+                        [](const Car &c) { return c.playerIndex; });
+  if (car == sim.cars.end()) {
+    TraceLog(LOG_WARNING, "netplay: no car for player %d", net.localPlayer);
+    return false;
+  }
+  net.localCar = int(car - sim.cars.begin());
+  return true;
+}
+
+// one tick with the local input, after the rollback the received inputs
+// call for; false without simulating when too far ahead of the peer
+bool NetStep(NetPlay &net, SimState &sim, const CarInputs &local) {
+  Receive(net, sim.frame);
+  Rollback(net, sim);
+  if (sim.frame - net.remoteTicks >= NetMaxRollback) {
+    Send(net, sim.frame);
+    return false;
+  }
+  net.inputs[sim.frame % NetHistory][0] = local;
+  RunTick(net, sim);
+  Send(net, sim.frame);
+  return true;
+}
+
+// after the last tick: true once the remote inputs up to ticks are in and
+// applied, and the peer has all the local ones
+bool NetSync(NetPlay &net, SimState &sim, int ticks) {
+  Receive(net, sim.frame);
+  Rollback(net, sim);
+  Send(net, sim.frame);
+  return net.remoteTicks >= ticks && net.remoteAck >= ticks;
+}
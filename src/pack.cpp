@@ -0,0 +1,324 @@
+#include "game.hpp"
+
+// Pack file: PackHeader, PackHeader::count PackEntry, then the blobs, each
+// 16 bytes aligned. Textures are stored with their mipmaps in the layout
+// rlLoadTexture takes, meshes as vertices, then texcoords, normals, colors
+// and indices when present, the way UploadMesh reads them. Both are uploaded
+// from the mapping and the file is closed once loaded.
+
+namespace {
+
+constexpr uint32_t PackVersion = 3;
+
+struct PackHeader {
+  char magic[4]{'M', 'P', 'A', 'K'};
+  uint32_t version{PackVersion};
+  uint32_t count{};
+};
+
+enum class PackKind : uint32_t {
+  Texture,
+  Mesh,
+};
+
+enum MeshAttribute : uint32_t {
+  Texcoords = 1,
+  Normals = 2,
+  Colors = 4,
+  Indices = 8,
+};
+
+struct PackEntry {
+  char name[24]{};
+  PackKind kind{};
+  uint32_t offset{};
+  uint32_t size{};
+  int32_t width{};
+  int32_t height{};
+  int32_t mipmaps{};
+  int32_t format{};
+  int32_t vertexCount{};
+  int32_t triangleCount{};
+  uint32_t attributes{};
+  Color color{};
+};
+
+struct PackWriter {
+  std::vector<PackEntry> entries{};
+  std::vector<uint8_t> data{};
+};
+
+void AddBlob(PackWriter &w, PackEntry &e, const void *p, size_t size) {
+  w.data.insert(w.data.end(), (const uint8_t *)p, (const uint8_t *)p + size);
+  e.size += size;
+}
+
+PackEntry &BeginEntry(PackWriter &w, const char *name, PackKind kind) {
+  w.data.resize((w.data.size() + 15) & ~size_t(15));
+  PackEntry &e = w.entries.emplace_back();
+  snprintf(e.name, sizeof(e.name), "%s", name);
+  e.kind = kind;
+  e.offset = w.data.size();
+  return e;
+}
+
+// takes ownership of img
+void AddTexture(PackWriter &w, const char *name, Image img, bool mipmaps) {
+  ImageFormat(&img, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+  if (mipmaps)
+    ImageMipmaps(&img);
+  PackEntry &e = BeginEntry(w, name, PackKind::Texture);
+  e.width = img.width;
+  e.height = img.height;
+  e.mipmaps = img.mipmaps;
+  e.format = img.format;
+  size_t size = 0;
+  for (int i = 0, mw = img.width, mh = img.height; i < img.mipmaps; ++i) {
+    size += GetPixelDataSize(mw, mh, img.format);
+    mw = std::max(1, mw / 2);
+    mh = std::max(1, mh / 2);
+  }
+  AddBlob(w, e, img.data, size);
+  UnloadImage(img);
+}
+
+void AddMesh(PackWriter &w, const char *name, const Mesh &mesh, Color color) {
+  PackEntry &e = BeginEntry(w, name, PackKind::Mesh);
+  e.vertexCount = mesh.vertexCount;
+  e.triangleCount = mesh.triangleCount;
+  e.color = color;
+  const size_t vc = mesh.vertexCount;
+  AddBlob(w, e, mesh.vertices, vc * 3 * sizeof(float));
+  if (mesh.texcoords) {
+    e.attributes |= Texcoords;
+    AddBlob(w, e, mesh.texcoords, vc * 2 * sizeof(float));
+  }
+  if (mesh.normals) {
+    e.attributes |= Normals;
+    AddBlob(w, e, mesh.normals, vc * 3 * sizeof(float));
+  }
+  if (mesh.colors) {
+    e.attributes |= Colors;
+    AddBlob(w, e, mesh.colors, vc * 4);
+  }
+  if (mesh.indices) {
+    e.attributes |= Indices;
+    AddBlob(w, e, mesh.indices, mesh.triangleCount * 3 * sizeof(uint16_t));
+  }
+}
+
+void AddMesh(PackWriter &w, const char *name, const MeshData &data) {
+  Mesh mesh{};
+  mesh.vertexCount = data.vertice.size();
+  mesh.triangleCount = data.indice.size() / 3;
+  mesh.vertices = (float *)data.vertice.data();
+  if (!data.uvs.empty())
+    mesh.texcoords = (float *)data.uvs.data();
+  if (!data.colors.empty())
+    mesh.colors = (unsigned char *)data.colors.data();
+  mesh.indices = (unsigned short *)data.indice.data();
+  AddMesh(w, name, mesh, WHITE);
+}
+
+const PackEntry *FindEntry(std::span<const PackEntry> entries,
+                           const char *name) {
+  for (const PackEntry &e : entries)
+    if (strncmp(e.name, name, sizeof(e.name)) == 0)
+      return &e;
+  return nullptr;
+}
+
+Texture UploadPackTexture(const MappedFile &file, const PackEntry &e) {
+  Texture t{};
+  t.id = rlLoadTexture(file.data + e.offset, e.width, e.height, e.format,
+                       e.mipmaps);
+  t.width = e.width;
+  t.height = e.height;
+  t.mipmaps = e.mipmaps;
+  t.format = e.format;
+  if (t.mipmaps > 1)
+    SetTextureFilter(t, TEXTURE_FILTER_BILINEAR);
+  return t;
+}
+
+// the CPU side pointers are cleared after the upload, they point in the
+// mapping which does not outlive the load
+Mesh UploadPackMesh(const MappedFile &file, const PackEntry &e) {
+  Mesh mesh{};
+  mesh.vertexCount = e.vertexCount;
+  mesh.triangleCount = e.triangleCount;
+  uint8_t *p = (uint8_t *)file.data + e.offset;
+  const auto take = [&](size_t size) {
+    uint8_t *r = p;
+    p += size;
+    return r;
+  };
+  const size_t vc = e.vertexCount;
+  mesh.vertices = (float *)take(vc * 3 * sizeof(float));
+  if (e.attributes & Texcoords)
+    mesh.texcoords = (float *)take(vc * 2 * sizeof(float));
+  if (e.attributes & Normals)
+    mesh.normals = (float *)take(vc * 3 * sizeof(float));
+  if (e.attributes & Colors)
+    mesh.colors = take(vc * 4);
+  if (e.attributes & Indices)
+    mesh.indices = (unsigned short *)take(e.triangleCount * 3 * 2);
+  UploadMesh(&mesh, false);
+  mesh.vertices = nullptr;
+  mesh.texcoords = nullptr;
+  mesh.normals = nullptr;
+  mesh.colors = nullptr;
+  mesh.indices = nullptr;
+  return mesh;
+}
+
+Model ModelFromMeshes(std::vector<Mesh> meshes, std::vector<Color> colors) {
+  Model mdl{};
+  mdl.transform = MatrixIdentity();
+  mdl.meshCount = meshes.size();
+  mdl.materialCount = meshes.size();
+  mdl.meshes = (Mesh *)MemAlloc(meshes.size() * sizeof(Mesh));
+  mdl.materials = (Material *)MemAlloc(meshes.size() * sizeof(Material));
+  mdl.meshMaterial = (int *)MemAlloc(meshes.size() * sizeof(int));
+  for (size_t i = 0; i < meshes.size(); ++i) {
+    mdl.meshes[i] = meshes[i];
+    mdl.materials[i] = LoadMaterialDefault();
+    mdl.materials[i].maps[MATERIAL_MAP_ALBEDO].color = colors[i];
+    mdl.meshMaterial[i] = i;
+  }
+  return mdl;
+}
+
+} // namespace
+
+// opens a hidden window, the tree goes through raylib's gltf importer which
+// uploads it
+bool BakePack(const char *path) {
+  SetConfigFlags(FLAG_WINDOW_HIDDEN);
+  InitWindow(64, 64, "bake");
+  PackWriter w;
+  const Image noise = LoadImage("assets/noise00.png");
+  AddTexture(w, "ground", MakeGroundImage(noise), true);
+  UnloadImage(noise);
+  AddTexture(w, "road", LoadImage("assets/road.png"), true);
+
+  for (size_t i = 0; i < CarVoxels.size(); ++i) {
+    const Voxel &vx = CarVoxels[i];
+    char name[24]{};
+    char file[64]{};
+    snprintf(name, sizeof(name), "car/%d", int(i));
+    snprintf(file, sizeof(file), "assets/car%02d.png", vx.texId);
+    const Image sheet = LoadImage(file);
+    AddMesh(w, name, MakeVoxelMesh(vx, sheet));
+    UnloadImage(sheet);
+  }
+
+  Model tree = LoadModel("assets/tree00.gltf");
+  for (int i = 0; i < tree.meshCount; ++i) {
+    const Material &mat = tree.materials[tree.meshMaterial[i]];
+    char name[24]{};
+    snprintf(name, sizeof(name), "tree00/%d", i);
+    AddMesh(w, name, tree.meshes[i], mat.maps[MATERIAL_MAP_ALBEDO].color);
+  }
+  UnloadModel(tree);
+  CloseWindow();
+
+  PackHeader header{.count = uint32_t(w.entries.size())};
+  const uint32_t base =
+      sizeof(PackHeader) + w.entries.size() * sizeof(PackEntry);
+  const uint32_t aligned = (base + 15) & ~15u;
+  for (PackEntry &e : w.entries)
+    e.offset += aligned;
+
+  FILE *f = fopen(path, "wb");
+  if (f == nullptr) {
+    TraceLog(LOG_WARNING, "can't write pack %s", path);
+    return false;
+  }
+  fwrite(&header, sizeof(header), 1, f);
+  fwrite(w.entries.data(), sizeof(PackEntry), w.entries.size(), f);
+  const std::array<uint8_t, 16> pad{};
+  fwrite(pad.data(), 1, aligned - base, f);
+  fwrite(w.data.data(), 1, w.data.size(), f);
+  fclose(f);
+  TraceLog(LOG_INFO, "pack %s: %d entries, %d bytes", path,
+           int(w.entries.size()), int(aligned + w.data.size()));
+  return true;
+}
+
+// runs on a loader task, the uploads read the mapping which is closed by
+// the last one
+bool LoadPack(Loader &loader, const char *path) {
+  auto file = MapFile(path);
+  if (!file)
+    return false;
+  PackHeader header{};
+  const PackHeader ref{};
+  if (file->size >= sizeof(header))
+    memcpy(&header, file->data, sizeof(header));
+  const size_t tableEnd =
+      sizeof(PackHeader) + size_t(header.count) * sizeof(PackEntry);
+  if (memcmp(header.magic, ref.magic, sizeof(ref.magic)) != 0 ||
+      header.version != PackVersion || tableEnd > file->size) {
+    TraceLog(LOG_WARNING, "invalid pack %s", path);
+    UnmapFile(*file);
+    return false;
+  }
+  std::vector<PackEntry> entries(header.count);
+  memcpy(entries.data(), file->data + sizeof(PackHeader),
+         entries.size() * sizeof(PackEntry));
+  for (const PackEntry &e : entries) {
+    if (size_t(e.offset) + e.size > file->size) {
+      TraceLog(LOG_WARNING, "invalid pack %s", path);
+      UnmapFile(*file);
+      return false;
+    }
+  }
+
+  const MappedFile mf = *file;
+  const auto texture = [&](const char *name, auto store) {
+    if (const PackEntry *e = FindEntry(entries, name))
+      QueueUpload(loader, [mf, e = *e, store](Context &ctx) {
+        store(ctx, UploadPackTexture(mf, e));
+      });
+  };
+  texture("ground", [](Context &ctx, Texture tex) { ctx.groundTex = tex; });
+  texture("road", [](Context &ctx, Texture tex) { ctx.roadTex = tex; });
+
+  for (size_t i = 0; i < CarVoxels.size(); ++i) {
+    char name[24]{};
+    snprintf(name, sizeof(name), "car/%d", int(i));
+    const PackEntry *e = FindEntry(entries, name);
+    if (e == nullptr)
+      continue;
+    QueueUpload(loader, [mf, e = *e, i](Context &ctx) {
+      ctx.mdlCars[i] = LoadModelFromMesh(UploadPackMesh(mf, e));
+    });
+  }
+
+  std::vector<PackEntry> tree;
+  for (int i = 0;; ++i) {
+    char name[24]{};
+    snprintf(name, sizeof(name), "tree00/%d", i);
+    const PackEntry *e = FindEntry(entries, name);
+    if (e == nullptr)
+      break;
+    tree.push_back(*e);
+  }
+  QueueUpload(loader, [mf, tree](Context &ctx) {
+    std::vector<Mesh> meshes;
+    std::vector<Color> colors;
+    for (const PackEntry &e : tree) {
+      meshes.push_back(UploadPackMesh(mf, e));
+      colors.push_back(e.color);
+    }
+    ctx.mdlTree = ModelFromMeshes(meshes, colors);
+  });
+
+  QueueUpload(loader, [mf](Context &) {
+    MappedFile file = mf;
+    UnmapFile(file);
+  });
+  TraceLog(LOG_INFO, "pack %s: %d entries", path, int(entries.size()));
+  return true;
+}
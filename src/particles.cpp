@@ -0,0 +1,34 @@
+#include "game.hpp"
+
+void SpawnParticle(Particles &ps, Vector2 pos, Vector2 speed, double t,
+                   float str) {
+  size_t i = (ps.first + ps.count) % MaxParticles;
+  if (ps.count == MaxParticles) {
+    ps.first = (ps.first + 1) % MaxParticles;
+    ps.dropped += 1;
+  } else {
+    ps.count += 1;
+  }
+  ps.pos[i] = pos;
+  ps.speed[i] = speed;
+  ps.t[i] = t;
+  ps.str[i] = str;
+}
+
+void UpdateParticles(Particles &ps, double gtime, float dt) {
+  while (ps.count != 0 && ps.t[ps.first] + PLifeTime < gtime) {
+    ps.first = (ps.first + 1) % MaxParticles;
+    ps.count -= 1;
+  }
+
+  const auto update = [&](size_t b, size_t e) {
+    for (size_t i = b; i < e; ++i) {
+      const float r = float((gtime - ps.t[i]) / PLifeTime);
+      ps.pos[i] = ps.pos[i] + (GameScale * (1 - r * r) * dt) * ps.speed[i];
+    }
+  };
+  const size_t end = ps.first + ps.count;
+  update(ps.first, std::min(end, MaxParticles));
+  if (end > MaxParticles)
+    update(0, end - MaxParticles);
+}
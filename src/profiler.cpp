@@ -0,0 +1,99 @@
+#include "game.hpp"
+
+// C++
+#include <chrono>
+
+namespace {
+
+constexpr std::array<const char *, size_t(Stage::Count)> StageNames{
+    "input",   "particles", "physics",   "collisions", "checkpoints",
+    "prepare", "view",      "composite", "minimap",
+};
+
+constexpr std::array<Color, size_t(Stage::Count)> StageColors{
+    SKYBLUE, PINK, ORANGE, RED, YELLOW, LIME, GREEN, PURPLE, BEIGE,
+};
+
+} // namespace
+
+int64_t ProfileNow() {
+  const auto t = std::chrono::steady_clock::now().time_since_epoch();
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(t).count();
+}
+
+void BeginProfileFrame(Profiler &p) {
+  if (!p.enabled)
+    return;
+  p.frame += 1;
+  p.frames[p.frame % Profiler::FrameCount] = {};
+}
+
+void EndProfile(Profiler &p, Stage stage, int index, int64_t start) {
+  const int64_t end = ProfileNow();
+  p.frames[p.frame % Profiler::FrameCount][size_t(stage)] +=
+      (end - start) * 1e-6f;
+  p.events[p.eventCount % Profiler::EventCount] = {start, end, stage, index};
+  p.eventCount += 1;
+}
+
+// stacked bars of the last frames, 4 pixels per ms, with the 60Hz budget
+void DrawProfileOverlay(const Profiler &p, int x, int y) {
+  const int height = 100;
+  const float pxPerMs = 4.0f;
+  const int width = 2 * Profiler::FrameCount;
+  DrawRectangle(x, y, width, height, {0, 0, 0, 160});
+  for (size_t i = 0; i < Profiler::FrameCount; ++i) {
+    const size_t f = p.frame + 1 + i;
+    const auto &times = p.frames[f % Profiler::FrameCount];
+    float top = float(y + height);
+    for (size_t s = 0; s < times.size(); ++s) {
+      const float h = std::min(pxPerMs * times[s], top - y);
+      top -= h;
+      DrawRectangleRec({float(x + 2 * i), top, 2.0f, h}, StageColors[s]);
+    }
+  }
+  const int budget = y + height - int(pxPerMs * 1000.0f / 60.0f);
+  DrawLine(x, budget, x + width, budget, RED);
+
+  std::array<float, size_t(Stage::Count)> avg{};
+  for (const auto &times : p.frames)
+    for (size_t s = 0; s < avg.size(); ++s)
+      avg[s] += times[s] / Profiler::FrameCount;
+  int ly = y + height + 2;
+  for (size_t s = 0; s < avg.size(); ++s) {
+    char txt[64]{};
+    snprintf(txt, sizeof(txt), "%s %.2f ms", StageNames[s], avg[s]);
+    DrawRectangle(x, ly + 3, 10, 10, StageColors[s]);
+    DrawText(txt, x + 14, ly, 16, WHITE);
+    ly += 16;
+  }
+}
+
+// Chrome trace format, opens in chrome://tracing or ui.perfetto.dev
+bool SaveProfileTrace(const Profiler &p, const char *path) {
+  FILE *f = fopen(path, "w");
+  if (f == nullptr) {
+    TraceLog(LOG_WARNING, "can't write profile %s", path);
+    return false;
+  }
+  const size_t count = std::min(p.eventCount, Profiler::EventCount);
+  const size_t first = p.eventCount - count;
+  const int64_t origin = count ? p.events[first % Profiler::EventCount].start
+                               : 0;
+  fprintf(f, "{\"traceEvents\": [\n");
+  for (size_t i = first; i < p.eventCount; ++i) {
+    const ProfileEvent &e = p.events[i % Profiler::EventCount];
+    char name[32]{};
+    snprintf(name, sizeof(name), e.stage == Stage::View ? "%s %d" : "%s",
+             StageNames[size_t(e.stage)], e.index);
+    fprintf(f,
+            "{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 0, \"tid\": 0, "
+            "\"ts\": %.3f, \"dur\": %.3f}%s\n",
+            name, (e.start - origin) * 1e-3, (e.end - e.start) * 1e-3,
+            i + 1 < p.eventCount ? "," : "");
+  }
+  fprintf(f, "]}\n");
+  fclose(f);
+  TraceLog(LOG_INFO, "profile: %d events saved to %s", int(count), path);
+  return true;
+}
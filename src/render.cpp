@@ -1,13 +1,69 @@
 
 #include "game.hpp"
 
+// grows rt to at least w x h, views then render to a sub-rect of it
 void UpdateRtSize(RenderTexture &rt, int w, int h) {
-  if (rt.texture.width == w && rt.texture.height == h)
+  if (rt.texture.width >= w && rt.texture.height >= h)
     return;
+  w = std::max(w, rt.texture.width);
+  h = std::max(h, rt.texture.height);
   TraceLog(LOG_INFO, "rebuild RT %dx%d", w, h);
   if (rt.texture.width != 0)
     UnloadRenderTexture(rt);
   rt = LoadRenderTexture(w, h);
+  SetTextureFilter(rt.texture, TEXTURE_FILTER_BILINEAR);
+}
+
+// Drops the view scale by a step as soon as frames run late, and raises it
+// back by half a step when the render work leaves room for it, after a
+// second at the same scale. Raising back to a scale that was just dropped
+// waits twice longer each time.
+void UpdateResolution(DynamicResolution &dr, float frameTime, float workTime,
+                      float budget) {
+  const float a = 0.1f;
+  dr.frameTime += a * (frameTime - dr.frameTime);
+  dr.workTime += a * (workTime - dr.workTime);
+  dr.stable += 1;
+  if (dr.frameTime > 1.1f * budget && dr.scale > MinRenderScale) {
+    if (dr.stable < 30)
+      return;
+    if (dr.raised) {
+      dr.failed = dr.scale;
+      dr.backoff = std::min(dr.backoff * 2, 32);
+    }
+    dr.scale = std::max(MinRenderScale, dr.scale - 0.1f);
+    dr.raised = false;
+    dr.stable = 0;
+  } else if (dr.frameTime < 1.05f * budget && dr.workTime < 0.6f * budget &&
+             dr.scale < 1.0f) {
+    const float next = std::min(1.0f, dr.scale + 0.05f);
+    if (dr.stable < (next >= dr.failed ? 60 * dr.backoff : 60))
+      return;
+    if (dr.raised && dr.scale >= dr.failed) {
+      dr.failed = INFINITY;
+      dr.backoff = 1;
+    }
+    dr.scale = next;
+    dr.raised = true;
+    dr.stable = 0;
+  }
+}
+
+// BeginMode3D for an orthographic camera seen through a viewport of size
+// dim, BeginMode3D taking its aspect from the whole render target
+void BeginViewMode3D(const Camera3D &cam, Vector2 dim) {
+  rlDrawRenderBatchActive();
+  rlMatrixMode(RL_PROJECTION);
+  rlPushMatrix();
+  rlLoadIdentity();
+  const double top = cam.fovy / 2.0;
+  const double right = top * dim.x / dim.y;
+  rlOrtho(-right, right, -top, top, RL_CULL_DISTANCE_NEAR,
+          RL_CULL_DISTANCE_FAR);
+  rlMatrixMode(RL_MODELVIEW);
+  rlLoadIdentity();
+  rlMultMatrixf(MatrixToFloat(MatrixLookAt(cam.position, cam.target, cam.up)));
+  rlEnableDepthTest();
 }
 
 template <typename... T>
@@ -18,19 +74,24 @@ int MyDrawText(int x, int y, Color col, int sz, const char *fmt, T &&...args) {
   return y + sz;
 }
 
-std::string StepToChrono(int steps) {
-  const int csec = (steps * 10) / 6;
+// laid out again when the centiseconds shown change
+void SetHudChrono(HudText &text, int steps, int tickRate) {
+  const int csec = int(int64_t(steps) * 100 / tickRate);
   const int a = csec % 100;
   const int b = (csec / 100) % 60;
   const int c = (csec / 100) / 60;
-  char buffer[128]{};
-  snprintf(buffer, sizeof(buffer), "%4d : %02d : %02d", c, b, a);
-  return buffer;
+  SetHudText(text, csec, "%4d : %02d : %02d", c, b, a);
+}
+
+// between the last two ticks, alpha being the part of a tick elapsed since
+// the last one
+Vector2 CarRenderPos(const Car &car, float alpha) {
+  return car.data.pos - (1.0f - alpha) * car.data.delta;
 }
 
 struct View3D {
 
-  static Camera3D GetCamera(Context &ctx, const Car &car, Vector2 dim) {
+  static Camera3D GetCamera(const Context &ctx, const Car &car, Vector2 dim) {
     Camera3D cam{};
     const float rtScale = 2.0f;
     Vector2 delta = 20.0f * car.data.speed;
@@ -40,7 +101,8 @@ struct View3D {
       delta = (maxdl / dl) * delta;
     }
     const float scale = 0.1f + 0.2f * exp(-dl / maxdl);
-    const Vector2 target = car.data.pos + GameScale * 2.5f * delta;
+    const Vector2 target =
+        CarRenderPos(car, ctx.simAlpha) + GameScale * 2.5f * delta;
     const float width = (1.0f / scale) * 300.0f;
     const float cf0 = 300.0f;
     const float cf1 = 0.0f;
@@ -57,84 +119,165 @@ struct View3D {
     return cam;
   }
 
-  static void RenderView(Context &ctx, const Car &car, Vector2 dim,
-                         int &propCount) {
+  // ground area seen by an orthographic camera, widened by margin
+  static Rectangle GetFootprint(const Camera3D &cam, Vector2 dim,
+                                float margin) {
+    const float ratio = dim.x / dim.y;
+    const Vector3 eye = Vector3Normalize(cam.target - cam.position);
+    const Vector3 left = Vector3Normalize(Vector3CrossProduct(eye, cam.up));
+    const Vector3 up = Vector3Normalize(Vector3CrossProduct(eye, left));
+    const float hw = margin + ratio * cam.fovy / 2.0f;
+    const float hh = margin + cam.fovy / 2.0f;
+    Vector2 vmin{INFINITY, INFINITY};
+    Vector2 vmax{-INFINITY, -INFINITY};
+    for (const float sx : {-hw, hw}) {
+      for (const float sy : {-hh, hh}) {
+        const Vector3 p = cam.position + sx * left + sy * up;
+        const Vector3 g = p + (-p.y / eye.y) * eye;
+        vmin = {std::min(vmin.x, g.x), std::min(vmin.y, g.z)};
+        vmax = {std::max(vmax.x, g.x), std::max(vmax.y, g.z)};
+      }
+    }
+    return {vmin.x, vmin.y, vmax.x - vmin.x, vmax.y - vmin.y};
+  }
+
+  // culls and fills the draw list of a view, safe to run on any thread
+  static void PrepareView(const Context &ctx, const Car &car, Vector2 dim,
+                          ViewDrawList &list) {
     const Camera3D cam = GetCamera(ctx, car, dim);
+    list.cam = cam;
+    list.propCount = 0;
+    list.propTested = 0;
+    list.props.resize(ctx.propBatches.size());
+    for (auto &transforms : list.props)
+      transforms.clear();
+    list.cars.clear();
+    list.particles.clear();
+    list.hudCount = 0;
+
+    const float ratio = dim.x / dim.y;
+    const Vector3 eye = cam.target - cam.position;
+    const Vector3 left = Vector3Normalize(Vector3CrossProduct(eye, cam.up));
+    const Vector3 up = Vector3Normalize(Vector3CrossProduct(eye, left));
+    const auto &track = ctx.track;
+    list.road.clear();
+    const Rectangle view = GetFootprint(cam, dim, 1.0f);
+    list.ground = view;
+    for (size_t i = 0; i < track.road.size(); ++i) {
+      if (CheckCollisionRecs(view, track.road[i].aabb))
+        list.road.push_back(i);
+    }
+
+    const Rectangle area = GetFootprint(cam, dim, track.propRadius);
+    QueryGrid(track.propGrid, area, [&](int i) {
+      const auto &prop = track.props[i];
+      const Vector3 &pos = std::get<0>(prop);
+      const float scale = std::get<1>(prop);
+      const Vector2 proj = {
+          Vector3DotProduct(pos - cam.position, left),
+          Vector3DotProduct(pos - cam.position, up),
+      };
+      list.propTested++;
+      if (abs(proj.x) > scale * 10.0f + ratio * cam.fovy / 2.0f ||
+          abs(proj.y) > scale * 10.0f + cam.fovy / 2.0f)
+        return;
+      list.propCount++;
+      const int b = ctx.propBatchIndex[i];
+      const Matrix m = MatrixMultiply(MatrixScale(scale, scale, scale),
+                                      MatrixTranslate(pos.x, pos.y, pos.z));
+      list.props[b].push_back(
+          MatrixMultiply(ctx.propBatches[b].model->transform, m));
+    });
+
+    // slide shake, the same in every view for a given frame
+    for (size_t i = 0; i < ctx.sim.cars.size(); ++i) {
+      const Car &c = ctx.sim.cars[i];
+      Rng rng = MakeRng(ctx.sim.frame * 0x9e3779b1u ^ (i + 1) * 0x85ebca6bu);
+      const float dir = Lerp(c.lastDir, c.data.dir, ctx.simAlpha);
+      const float a =
+          180.0f + c.data.slide * rng.Range(-2, 2) + dir * 180.0 / PI;
+      const Matrix rot = MatrixRotate({0.0f, -1.0f, 0.0f}, a * DEG2RAD);
+      const Vector2 p = CarRenderPos(c, ctx.simAlpha);
+      const Matrix pos = MatrixTranslate(p.x, 0, p.y);
+      list.cars.push_back({c.model, MatrixMultiply(rot, pos)});
+    }
+
+    // moved forward by the part of a tick elapsed, as UpdateParticles would
+    const Particles &ps = ctx.sim.particles;
+    const float dt = ctx.simAlpha / ctx.sim.tickRate;
+    const double t = ctx.sim.gtime + dt;
+    ForEachParticle(ps, [&](size_t i) {
+      const float r = std::min(1.0f, float((t - ps.t[i]) / PLifeTime));
+      const float sz = GameScale * r * 32;
+      const float a = ps.str[i] * (1 - r) * (155.0f / 255.0f);
+      const Vector2 pos =
+          ps.pos[i] + (GameScale * (1 - r * r) * dt) * ps.speed[i];
+      const Matrix m{
+          sz, 0, 0, pos.x, 0, sz, 0, sz, 0, 0, sz, pos.y, 0, 0, 0, a,
+      };
+      list.particles.push_back(m);
+    });
+
+    if (car.playerIndex) {
+      const Player &p = ctx.sim.players[*car.playerIndex];
+      const int frames = p.startFrame ? ctx.sim.frame - *p.startFrame : 0;
+      SetHudText(list.hud[0], p.lastCP, "cp: %d", p.lastCP);
+      const int rate = ctx.sim.tickRate;
+      SetHudChrono(list.hud[1], p.bestChrono.value_or(0), rate);
+      SetHudChrono(list.hud[2], ctx.sim.bestChrono.value_or(0), rate);
+      SetHudChrono(list.hud[3], frames, rate);
+      list.hudCount = HudLines;
+    }
+  }
+
+  // replays a draw list into the current viewport of size dim, main thread
+  // only; the HUD is drawn over the composited view
+  static void SubmitView(Context &ctx, const ViewDrawList &list, Vector2 dim) {
     ClearBackground(PINK);
-    BeginMode3D(cam);
-    {
-      {
-        const float ratio = dim.x / dim.y;
-        const Vector3 eye = cam.target - cam.position;
-        const Vector3 left = Vector3Normalize(Vector3CrossProduct(eye, cam.up));
-        const Vector3 up = Vector3Normalize(Vector3CrossProduct(eye, left));
-        for (const auto &prop : ctx.track.props) {
-          const Vector3 &pos = std::get<0>(prop);
-          const float scale = std::get<1>(prop);
-          const Vector2 proj = {
-              Vector3DotProduct(pos - cam.position, left),
-              Vector3DotProduct(pos - cam.position, up),
-          };
-          if (abs(proj.x) > scale * 10.0f + ratio * cam.fovy / 2.0f ||
-              abs(proj.y) > scale * 10.0f + cam.fovy / 2.0f)
-            continue;
-          propCount++;
-          DrawModel(*std::get<2>(prop), pos, scale, BROWN);
-        }
-        for (const auto &checkppint : ctx.track.checkpoints) {
-          const std::tuple<Vector2, Color> ps[2] = {
-              {checkppint.pos + checkppint.delta, RED},
-              {checkppint.pos - checkppint.delta, BLUE},
-          };
-          for (const auto &[p, c] : ps) {
-            DrawCube({p.x, 0, p.y}, 4, 10, 4, c);
-          }
-        }
-      }
-      DrawModel(ctx.mdlGround, {0, -0.01f, 0}, 1, BROWN);
-      for (const auto &mdl : ctx.track.models)
-        DrawModel(mdl, {}, 1, WHITE);
-      for (const Car &car : ctx.cars) {
-        const float a = 180.0f + car.data.slide * GetRandomValue(-2, 2) +
-                        car.data.dir * 180.0 / PI;
-        DrawModelEx(ctx.mdlCars[car.model], {car.data.pos.x, 0, car.data.pos.y},
-                    {0.0f, -1.0f, 0.0f}, a, {1.0f, 1.0f, 1.0f}, WHITE);
-      }
-      std::vector<Matrix> transforms;
-      for (Particle &p : ctx.particles) {
-        const float r = float((ctx.gtime - p.t) / PLifeTime);
-        const float sz = GameScale * r * 32;
-        const float a = p.str * (1 - r) * (155.0f / 255.0f);
-        const Matrix m{
-            sz, 0, 0, p.pos.x, 0, sz, 0, sz, 0, 0, sz, p.pos.y, 0, 0, 0, a,
-        };
-        transforms.push_back(m);
+    BeginViewMode3D(list.cam, dim);
+    for (size_t b = 0; b < list.props.size(); ++b) {
+      const auto &transforms = list.props[b];
+      if (transforms.empty())
+        continue;
+      const PropBatch &batch = ctx.propBatches[b];
+      const Model &mdl = *batch.model;
+      for (int m = 0; m < mdl.meshCount; ++m)
+        DrawMeshInstanced(mdl.meshes[m], batch.materials[mdl.meshMaterial[m]],
+                          transforms.data(), transforms.size());
+    }
+    for (const auto &checkppint : ctx.track.checkpoints) {
+      const std::tuple<Vector2, Color> ps[2] = {
+          {checkppint.pos + checkppint.delta, RED},
+          {checkppint.pos - checkppint.delta, BLUE},
+      };
+      for (const auto &[p, c] : ps) {
+        DrawCube({p.x, 0, p.y}, 4, 10, 4, c);
       }
-      if (!transforms.empty())
-        DrawMeshInstanced(ctx.mdlParticle.meshes[0],
-                          ctx.mdlParticle.materials[0], &transforms[0],
-                          transforms.size());
     }
-    EndMode3D();
-    if (car.playerIndex) {
-      const Player &p = ctx.players[*car.playerIndex];
-      const int frames = p.startFrame ? ctx.frame - *p.startFrame : 0;
-      const std::string currentChrono = StepToChrono(frames);
-      const std::string allBestChrono = StepToChrono(p.bestChrono.value_or(0));
-      const std::string myBestChrono = StepToChrono(ctx.bestChrono.value_or(0));
-      int y = 0;
-      y = MyDrawText(0, y, WHITE, 20, "cp: %d", p.lastCP);
-      y = MyDrawText(0, y, WHITE, 20, "%s", allBestChrono.c_str());
-      y = MyDrawText(0, y, WHITE, 20, "%s", myBestChrono.c_str());
-      y = MyDrawText(0, y, WHITE, 20, "%s", currentChrono.c_str());
+    const Rectangle &g = list.ground;
+    DrawModelEx(ctx.mdlGround,
+                {g.x + 0.5f * g.width, -0.01f, g.y + 0.5f * g.height},
+                {0, 1, 0}, 0, {g.width, 1, g.height}, BROWN);
+    for (const int i : list.road)
+      DrawModel(ctx.track.road[i].model, {}, 1, WHITE);
+    for (const CarInstance &c : list.cars) {
+      const Model &mdl = ctx.mdlCars[c.model];
+      const Matrix m = MatrixMultiply(mdl.transform, c.transform);
+      for (int i = 0; i < mdl.meshCount; ++i)
+        DrawMesh(mdl.meshes[i], mdl.materials[mdl.meshMaterial[i]], m);
     }
+    if (!list.particles.empty())
+      DrawMeshInstanced(ctx.mdlParticle.meshes[0],
+                        ctx.mdlParticle.materials[0], list.particles.data(),
+                        list.particles.size());
+    EndMode3D();
   }
 };
 
 void RenderMinimap(Context &ctx, Vector2 center, float scale) {
   const Vector2 pos{ctx.W - 266.0f, 10.0f};
   DrawTextureEx(ctx.trackTex, pos, 0, 1 / 4.0f, {255, 255, 255, 128});
-  for (const Car &car : ctx.cars) {
+  for (const Car &car : ctx.sim.cars) {
     const auto &bb = ctx.track.aabb;
     const float x = 256.0f * (car.data.pos.x - bb.x) / bb.width;
     const float y = 256.0f * (car.data.pos.y - bb.y) / bb.height;
@@ -143,6 +286,15 @@ void RenderMinimap(Context &ctx, Vector2 center, float scale) {
   }
 }
 
+void Render_Loading(Context &ctx) {
+  const float w = 400.0f;
+  const float x = 0.5f * (GetScreenWidth() - w);
+  const float y = 0.5f * GetScreenHeight();
+  MyDrawText(int(x), int(y) - 50, WHITE, 40, "loading");
+  DrawRectangleLinesEx({x, y, w, 20.0f}, 2.0f, WHITE);
+  DrawRectangleRec({x, y, w * LoadProgress(ctx.loader), 20.0f}, WHITE);
+}
+
 void Render_Main(Context &ctx) {
   int y = 100;
   y = MyDrawText(200, y, WHITE, 40, "press start");
@@ -150,133 +302,190 @@ void Render_Main(Context &ctx) {
 
 void Render_PlayerSelect(Context &ctx) {
   int y = 100;
-  for (size_t i = 0; i < ctx.players.size(); ++i) {
-    const auto &p = ctx.players[i];
+  for (size_t i = 0; i < ctx.sim.players.size(); ++i) {
+    const auto &p = ctx.sim.players[i];
     const Color c = p.enabled ? WHITE : GRAY;
     y = MyDrawText(200, y, c, 40, "player");
   }
 }
 
 void Render_Race(Context &ctx) {
-  std::vector<std::tuple<Car *, Rectangle>> views;
+  using ViewRect = std::tuple<Car *, Rectangle>;
+  FrameVector<ViewRect> views{ArenaAllocator<ViewRect>(ctx.frameArena)};
+  views.reserve(ctx.drawLists.size());
   std::pair<int, int> rtSize;
 
   const int rtoi = 1;
   const float rtof = rtoi;
 
-  const int playerCount = ctx.cars.size();
+  auto &cars = ctx.sim.cars;
+  // players come first, bots get no view
+  const int playerCount =
+      std::count_if(cars.begin(), cars.end(),
+                    [](const Car &car) { return car.playerIndex.has_value(); });
   if (playerCount == 1) {
     rtSize = {
         GetScreenWidth(),
         GetScreenHeight(),
     };
-    views.emplace_back(&ctx.cars[0], Rectangle{
-                                         0.0f,
-                                         0.0f,
-                                         float(GetScreenWidth()),
-                                         float(GetScreenHeight()),
-                                     });
+    views.emplace_back(&cars[0], Rectangle{
+                                     0.0f,
+                                     0.0f,
+                                     float(GetScreenWidth()),
+                                     float(GetScreenHeight()),
+                                 });
   } else if (playerCount == 2) {
     rtSize = {
         GetScreenWidth() / 2 - 2 * rtoi,
         GetScreenHeight(),
     };
-    views.emplace_back(&ctx.cars[0], Rectangle{
-                                         rtof,
-                                         0.0f,
-                                         GetScreenWidth() / 2.0f - 2 * rtof,
-                                         float(GetScreenHeight()),
-                                     });
-    views.emplace_back(&ctx.cars[1], Rectangle{
-                                         rtof + GetScreenWidth() / 2.0f,
-                                         0.0f,
-                                         GetScreenWidth() / 2.0f - 2 * rtof,
-                                         float(GetScreenHeight()),
-                                     });
+    views.emplace_back(&cars[0], Rectangle{
+                                     rtof,
+                                     0.0f,
+                                     GetScreenWidth() / 2.0f - 2 * rtof,
+                                     float(GetScreenHeight()),
+                                 });
+    views.emplace_back(&cars[1], Rectangle{
+                                     rtof + GetScreenWidth() / 2.0f,
+                                     0.0f,
+                                     GetScreenWidth() / 2.0f - 2 * rtof,
+                                     float(GetScreenHeight()),
+                                 });
   } else if (playerCount == 4) {
     rtSize = {
         GetScreenWidth() / 2 - 2 * rtoi,
         GetScreenHeight() / 2 - 2 * rtoi,
     };
-    views.emplace_back(&ctx.cars[0], Rectangle{
-                                         rtof,
-                                         rtof,
-                                         GetScreenWidth() / 2.0f - 2 * rtof,
-                                         GetScreenHeight() / 2.0f - 2 * rtof,
-                                     });
-    views.emplace_back(&ctx.cars[1], Rectangle{
-                                         rtof + GetScreenWidth() / 2.0f,
-                                         rtof,
-                                         GetScreenWidth() / 2.0f - 2 * rtof,
-                                         GetScreenHeight() / 2.0f - 2 * rtof,
-                                     });
-    views.emplace_back(&ctx.cars[2], Rectangle{
-                                         rtof,
-                                         rtof + GetScreenHeight() / 2.0f,
-                                         GetScreenWidth() / 2.0f - 2 * rtof,
-                                         GetScreenHeight() / 2.0f - 2 * rtof,
-                                     });
-    views.emplace_back(&ctx.cars[3], Rectangle{
-                                         rtof + GetScreenWidth() / 2.0f,
-                                         rtof + GetScreenHeight() / 2.0f,
-                                         GetScreenWidth() / 2.0f - 2 * rtof,
-                                         GetScreenHeight() / 2.0f - 2 * rtof,
-                                     });
+    views.emplace_back(&cars[0], Rectangle{
+                                     rtof,
+                                     rtof,
+                                     GetScreenWidth() / 2.0f - 2 * rtof,
+                                     GetScreenHeight() / 2.0f - 2 * rtof,
+                                 });
+    views.emplace_back(&cars[1], Rectangle{
+                                     rtof + GetScreenWidth() / 2.0f,
+                                     rtof,
+                                     GetScreenWidth() / 2.0f - 2 * rtof,
+                                     GetScreenHeight() / 2.0f - 2 * rtof,
+                                 });
+    views.emplace_back(&cars[2], Rectangle{
+                                     rtof,
+                                     rtof + GetScreenHeight() / 2.0f,
+                                     GetScreenWidth() / 2.0f - 2 * rtof,
+                                     GetScreenHeight() / 2.0f - 2 * rtof,
+                                 });
+    views.emplace_back(&cars[3], Rectangle{
+                                     rtof + GetScreenWidth() / 2.0f,
+                                     rtof + GetScreenHeight() / 2.0f,
+                                     GetScreenWidth() / 2.0f - 2 * rtof,
+                                     GetScreenHeight() / 2.0f - 2 * rtof,
+                                 });
   }
 
-  int propCount{};
+  // views render at scale to the corner of their target at the origin
+  const float scale = ctx.resolution.scale;
+  std::array<Vector2, 4> scaled{};
+  for (size_t i = 0; i < views.size(); ++i) {
+    UpdateRtSize(ctx.rts[i], rtSize.first, rtSize.second);
+    const Rectangle &rect = std::get<Rectangle>(views[i]);
+    scaled[i] = {
+        std::max(1.0f, roundf(scale * rect.width)),
+        std::max(1.0f, roundf(scale * rect.height)),
+    };
+  }
 
   {
-    int rti{};
-    for (const auto &i : views) {
-      auto &crt = ctx.rts[rti++];
-      UpdateRtSize(crt, rtSize.first, rtSize.second);
-      const Vector2 dim{
-          float(crt.texture.width),
-          float(crt.texture.height),
-      };
-      BeginTextureMode(crt);
-      View3D::RenderView(ctx, *std::get<Car *>(i), dim, propCount);
-      EndTextureMode();
-    }
+    const ProfileScope scope(&ctx.profiler, Stage::Prepare);
+    ParallelFor(ctx.jobs, views.size(), [&](size_t i) {
+      const Rectangle &rect = std::get<Rectangle>(views[i]);
+      const Vector2 dim{rect.width, rect.height};
+      View3D::PrepareView(ctx, *std::get<Car *>(views[i]), dim,
+                          ctx.drawLists[i]);
+    });
+  }
+
+  int propCount{};
+  int propTested{};
+  int roadCount{};
+  for (size_t i = 0; i < views.size(); ++i) {
+    const ProfileScope scope(&ctx.profiler, Stage::View, i);
+    const ViewDrawList &list = ctx.drawLists[i];
+    BeginTextureMode(ctx.rts[i]);
+    rlViewport(0, 0, int(scaled[i].x), int(scaled[i].y));
+    View3D::SubmitView(ctx, list, scaled[i]);
+    EndTextureMode();
+    propCount += list.propCount;
+    roadCount += list.road.size();
+    propTested += list.propTested;
   }
 
   {
+    const ProfileScope scope(&ctx.profiler, Stage::Composite);
     rlDisableColorBlend();
-    int rti{};
-    for (const auto &i : views) {
-      const auto &crt = ctx.rts[rti++];
-      const Vector2 dim{
-          float(crt.texture.width),
-          float(crt.texture.height),
-      };
-      const auto &rt = crt.texture;
-      const Rectangle src{0.0f, 0.0f, dim.x, -dim.y};
-      DrawTexturePro(rt, src, std::get<Rectangle>(i), {0, 0}, 0, WHITE);
+    // upscaled, the edge samples would blend in the texels past the view
+    const float inset = scale < 1.0f ? 0.5f : 0.0f;
+    for (size_t i = 0; i < views.size(); ++i) {
+      const auto &rt = ctx.rts[i].texture;
+      const Rectangle src{inset, inset, scaled[i].x - 2.0f * inset,
+                          2.0f * inset - scaled[i].y};
+      DrawTexturePro(rt, src, std::get<Rectangle>(views[i]), {0, 0}, 0,
+                     WHITE);
     }
     rlDrawRenderBatchActive();
     rlEnableColorBlend();
+    for (size_t i = 0; i < views.size(); ++i) {
+      const Rectangle &rect = std::get<Rectangle>(views[i]);
+      ctx.drawLists[i].hudOrigin = {floorf(rect.x), floorf(rect.y)};
+    }
+    DrawHud(std::span(ctx.drawLists).first(views.size()));
   }
 
-  RenderMinimap(ctx, {}, 1.0f);
+  {
+    const ProfileScope scope(&ctx.profiler, Stage::Minimap);
+    RenderMinimap(ctx, {}, 1.0f);
+    rlDrawRenderBatchActive();
+  }
 
   if (ctx.showDebug) {
     int y = 0;
-    y = MyDrawText(0, y, WHITE, 20, "%d fps", GetFPS());
-    y = MyDrawText(0, y, WHITE, 20, "%d props", propCount);
+    y = MyDrawText(0, y, WHITE, 20, "%d fps, %d%% resolution", GetFPS(),
+                   int(100.0f * ctx.resolution.scale + 0.5f));
+    y = MyDrawText(0, y, WHITE, 20, "%d props (%d tested)", propCount,
+                   propTested);
+    y = MyDrawText(0, y, WHITE, 20, "%d / %d road chunks", roadCount,
+                   int(views.size() * ctx.track.road.size()));
+    y = MyDrawText(0, y, WHITE, 20, "%d particles (%d dropped)",
+                   int(ctx.sim.particles.count),
+                   int(ctx.sim.particles.dropped));
+#ifdef DEBUG
+    y = MyDrawText(0, y, WHITE, 20, "%d heap allocations",
+                   int(ctx.frameAllocations));
+#endif
+    if (ctx.net)
+      y = MyDrawText(0, y, WHITE, 20, "%d ahead, %d rollbacks (last %d)",
+                     ctx.sim.frame - ctx.net->remoteTicks, ctx.net->rollbacks,
+                     ctx.net->lastRollback);
+    DrawProfileOverlay(ctx.profiler, 0, y + 4);
   }
 }
 
 void Render(Context &ctx) {
   using RenderFn = void(Context &);
   RenderFn *const r[int(State::Count)] = {
+      Render_Loading,
       Render_Main,
       Render_PlayerSelect,
       Render_Race,
   };
-  ctx.frame += 1;
+  const int64_t start = ProfileNow();
   BeginDrawing();
   ClearBackground(BLACK);
   r[int(ctx.state)](ctx);
+  const float work = (ProfileNow() - start) * 1e-9f;
+  const float frame = GetFrameTime();
   EndDrawing();
+  if (ctx.state == State::Race) {
+    const int fps = ctx.targetFps > 0 ? ctx.targetFps : 60;
+    UpdateResolution(ctx.resolution, frame, work, 1.0f / fps);
+  }
 }
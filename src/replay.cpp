@@ -0,0 +1,307 @@
+#include "game.hpp"
+
+// Replay file: ReplayHeader, 2 bytes per car (player index or -1, model),
+// the input stream, then fixed size keyframes.
+//
+// The stream is a sequence of tokens, one or more ticks each:
+//   0x01..0x7f  the previous inputs repeated for that many ticks
+//   0x80        per car: flags, then the zigzag varint wheel delta if changed
+//   0x81        per car: flags and the absolute wheel, starts each keyframe
+// flags: 1 thrust, 2 brake, 4 handbrake, 8 wheel changed
+
+namespace {
+
+constexpr uint8_t TokenDelta = 0x80;
+constexpr uint8_t TokenAbsolute = 0x81;
+constexpr int MaxRun = 0x7f;
+constexpr int32_t NoValue = INT32_MIN;
+
+template <typename T> void Put(std::vector<uint8_t> &out, const T &v) {
+  const uint8_t *p = (const uint8_t *)&v;
+  out.insert(out.end(), p, p + sizeof(T));
+}
+
+template <typename T> T Get(const uint8_t *&p) {
+  T v;
+  memcpy(&v, p, sizeof(T));
+  p += sizeof(T);
+  return v;
+}
+
+int Wheel(const CarInputs &in) { return int(roundf(in.cwheel * 127.0f)); }
+
+uint8_t Flags(const CarInputs &in) {
+  return (in.cthrust > 0.5f ? 1 : 0) | (in.brake > 0.5f ? 2 : 0) |
+         (in.handbrake > 0.5f ? 4 : 0);
+}
+
+CarInputs MakeInputs(uint8_t flags, int wheel) {
+  return {
+      .cwheel = wheel / 127.0f,
+      .cthrust = (flags & 1) ? 1.0f : 0.0f,
+      .brake = (flags & 2) ? 1.0f : 0.0f,
+      .handbrake = (flags & 4) ? 1.0f : 0.0f,
+  };
+}
+
+uint32_t KeyframeSize(uint32_t carCount) {
+  return 24 + 16 * std::tuple_size_v<decltype(SimState::players)> +
+         carCount * (sizeof(CarData) + sizeof(TrackPos));
+}
+
+void FlushRun(ReplayWriter &w) {
+  if (w.run == 0)
+    return;
+  w.stream.push_back(uint8_t(w.run));
+  w.run = 0;
+}
+
+void PutKeyframe(ReplayWriter &w, const SimState &sim) {
+  auto &out = w.keyframes;
+  Put(out, w.header.tickCount);
+  Put(out, uint32_t(w.stream.size()));
+  Put(out, sim.gtime);
+  Put(out, int32_t(sim.frame));
+  Put(out, int32_t(sim.bestChrono.value_or(NoValue)));
+  for (const Player &p : sim.players) {
+    Put(out, int32_t(p.lastCP));
+    Put(out, int32_t(p.laps));
+    Put(out, int32_t(p.startFrame.value_or(NoValue)));
+    Put(out, int32_t(p.bestChrono.value_or(NoValue)));
+  }
+  for (const Car &car : sim.cars) {
+    Put(out, car.data);
+    Put(out, car.trackPos);
+  }
+}
+
+void GetKeyframe(const ReplayReader &r, int index, SimState &sim) {
+  const auto opt = [](int32_t v) -> std::optional<int> {
+    return v != NoValue ? std::make_optional(int(v)) : std::nullopt;
+  };
+  const uint8_t *p = r.file.data + r.header.keyframeOffset +
+                     size_t(index) * r.header.keyframeSize;
+  Get<uint32_t>(p);
+  Get<uint32_t>(p);
+  sim.gtime = Get<double>(p);
+  sim.frame = Get<int32_t>(p);
+  sim.bestChrono = opt(Get<int32_t>(p));
+  for (Player &player : sim.players) {
+    player.lastCP = Get<int32_t>(p);
+    player.laps = Get<int32_t>(p);
+    player.startFrame = opt(Get<int32_t>(p));
+    player.bestChrono = opt(Get<int32_t>(p));
+  }
+  for (Car &car : sim.cars) {
+    car.data = Get<CarData>(p);
+    car.lastDir = car.data.dir;
+    car.trackPos = Get<TrackPos>(p);
+  }
+  sim.particles.first = 0;
+  sim.particles.count = 0;
+}
+
+} // namespace
+
+void BeginReplay(ReplayWriter &w, uint32_t trackSeed, const SimState &sim) {
+  w = {};
+  w.header.tickRate = sim.tickRate;
+  w.header.trackSeed = trackSeed;
+  w.header.carCount = sim.cars.size();
+  w.header.keyframeInterval = ReplayKeyframeInterval;
+  w.header.keyframeSize = KeyframeSize(sim.cars.size());
+  for (const Car &car : sim.cars) {
+    w.cars.push_back(uint8_t(int8_t(car.playerIndex.value_or(-1))));
+    w.cars.push_back(uint8_t(car.model));
+  }
+  w.last.resize(sim.cars.size());
+}
+
+// called before each SimStep with the inputs it is given
+void RecordTick(ReplayWriter &w, const SimState &sim,
+                std::span<const CarInputs> inputs) {
+  const size_t count = w.last.size();
+  const auto input = [&](size_t i) {
+    return i < inputs.size() ? inputs[i] : CarInputs{};
+  };
+
+  if (w.header.tickCount % w.header.keyframeInterval == 0) {
+    FlushRun(w);
+    PutKeyframe(w, sim);
+    w.header.keyframeCount += 1;
+    w.stream.push_back(TokenAbsolute);
+    for (size_t i = 0; i < count; ++i) {
+      w.stream.push_back(Flags(input(i)));
+      w.stream.push_back(uint8_t(int8_t(Wheel(input(i)))));
+    }
+  } else {
+    bool same = true;
+    for (size_t i = 0; i < count && same; ++i)
+      same = Flags(input(i)) == Flags(w.last[i]) &&
+             Wheel(input(i)) == Wheel(w.last[i]);
+    if (same) {
+      if (++w.run == MaxRun)
+        FlushRun(w);
+    } else {
+      FlushRun(w);
+      w.stream.push_back(TokenDelta);
+      for (size_t i = 0; i < count; ++i) {
+        const int delta = Wheel(input(i)) - Wheel(w.last[i]);
+        w.stream.push_back(Flags(input(i)) | (delta != 0 ? 8 : 0));
+        if (delta == 0)
+          continue;
+        uint32_t zz = uint32_t((delta << 1) ^ (delta >> 31));
+        for (; zz >= 0x80; zz >>= 7)
+          w.stream.push_back(uint8_t(zz | 0x80));
+        w.stream.push_back(uint8_t(zz));
+      }
+    }
+  }
+
+  for (size_t i = 0; i < count; ++i)
+    w.last[i] = input(i);
+  w.header.tickCount += 1;
+}
+
+bool SaveReplay(ReplayWriter &w, const char *path) {
+  FlushRun(w);
+  w.header.streamOffset = sizeof(ReplayHeader) + w.cars.size();
+  w.header.keyframeOffset = w.header.streamOffset + w.stream.size();
+  FILE *f = fopen(path, "wb");
+  if (f == nullptr) {
+    TraceLog(LOG_WARNING, "can't write replay %s", path);
+    return false;
+  }
+  fwrite(&w.header, sizeof(w.header), 1, f);
+  fwrite(w.cars.data(), 1, w.cars.size(), f);
+  fwrite(w.stream.data(), 1, w.stream.size(), f);
+  fwrite(w.keyframes.data(), 1, w.keyframes.size(), f);
+  fclose(f);
+  TraceLog(LOG_INFO, "replay %s: %d ticks, %d bytes", path,
+           int(w.header.tickCount),
+           int(w.header.keyframeOffset + w.keyframes.size()));
+  return true;
+}
+
+std::optional<ReplayReader> OpenReplay(const char *path) {
+  auto file = MapFile(path);
+  if (!file)
+    return {};
+  ReplayReader r{.file = *file};
+  const ReplayHeader ref{};
+  if (r.file.size >= sizeof(ReplayHeader))
+    memcpy(&r.header, r.file.data, sizeof(ReplayHeader));
+  const auto &h = r.header;
+  if (r.file.size < sizeof(ReplayHeader) ||
+      memcmp(h.magic, ref.magic, sizeof(h.magic)) != 0 ||
+      h.version != ref.version || h.tickRate == 0 || h.keyframeCount == 0 ||
+      h.keyframeInterval == 0 || h.keyframeSize != KeyframeSize(h.carCount) ||
+      h.streamOffset < sizeof(ReplayHeader) + 2 * size_t(h.carCount) ||
+      h.streamOffset > h.keyframeOffset ||
+      (h.streamOffset == h.keyframeOffset && h.tickCount > 0) ||
+      h.keyframeOffset + size_t(h.keyframeCount) * h.keyframeSize >
+          r.file.size) {
+    TraceLog(LOG_WARNING, "invalid replay %s", path);
+    UnmapFile(r.file);
+    return {};
+  }
+  r.offset = h.streamOffset;
+  r.end = h.keyframeOffset;
+  r.last.resize(h.carCount);
+  return r;
+}
+
+void CloseReplay(ReplayReader &r) { UnmapFile(r.file); }
+
+void InitReplayCars(const ReplayReader &r, SimState &sim) {
+  sim.cars.clear();
+  sim.players = {};
+  sim.tickRate = r.header.tickRate;
+  const uint8_t *p = r.file.data + sizeof(ReplayHeader);
+  for (uint32_t i = 0; i < r.header.carCount; ++i) {
+    Car &car = sim.cars.emplace_back();
+    const int player = int8_t(p[2 * i]);
+    car.model = p[2 * i + 1];
+    if (player >= 0 && player < int(sim.players.size())) {
+      car.playerIndex = player;
+      sim.players[player].enabled = true;
+    }
+  }
+  GetKeyframe(r, 0, sim);
+}
+
+// false at the end of the replay, or where the stream is cut or corrupt
+bool ReadReplayTick(ReplayReader &r, std::span<CarInputs> inputs) {
+  if (r.tick >= int(r.header.tickCount))
+    return false;
+  if (r.run > 0) {
+    r.run -= 1;
+  } else {
+    if (r.offset >= r.end)
+      return false;
+    const uint8_t *p = r.file.data + r.offset;
+    const uint8_t *const end = r.file.data + r.end;
+    const auto next = [&](uint8_t &b) {
+      if (p == end)
+        return false;
+      b = *p++;
+      return true;
+    };
+    uint8_t token{};
+    if (!next(token) || token == 0 || token > TokenAbsolute)
+      return false;
+    if (token < TokenDelta) {
+      r.run = token - 1;
+    } else {
+      for (CarInputs &last : r.last) {
+        uint8_t flags{};
+        if (!next(flags))
+          return false;
+        int wheel = Wheel(last);
+        if (token == TokenAbsolute) {
+          uint8_t b{};
+          if (!next(b))
+            return false;
+          wheel = int8_t(b);
+        } else if (flags & 8) {
+          // 5 bytes hold the 32 bits
+          uint32_t zz = 0;
+          for (int shift = 0;; shift += 7) {
+            uint8_t b{};
+            if (shift > 28 || !next(b))
+              return false;
+            zz |= uint32_t(b & 0x7f) << shift;
+            if ((b & 0x80) == 0)
+              break;
+          }
+          wheel += int(zz >> 1) ^ -int(zz & 1);
+        }
+        last = MakeInputs(flags, wheel);
+      }
+    }
+    r.offset = p - r.file.data;
+  }
+  std::copy_n(r.last.begin(), std::min(r.last.size(), inputs.size()),
+              inputs.begin());
+  r.tick += 1;
+  return true;
+}
+
+// restart from the closest keyframe before tick and simulate up to it
+void SeekReplay(ReplayReader &r, SimState &sim, int tick) {
+  const auto &h = r.header;
+  tick = std::clamp(tick, 0, int(h.tickCount));
+  const int index = std::min(tick / int(h.keyframeInterval),
+                             int(h.keyframeCount) - 1);
+  GetKeyframe(r, index, sim);
+  const uint8_t *p = r.file.data + h.keyframeOffset +
+                     size_t(index) * h.keyframeSize;
+  r.tick = Get<uint32_t>(p);
+  r.offset = h.streamOffset + Get<uint32_t>(p);
+  r.run = 0;
+
+  std::vector<CarInputs> inputs(h.carCount);
+  while (r.tick < tick && ReadReplayTick(r, inputs)) {
+    SimStep(sim, inputs);
+  }
+}
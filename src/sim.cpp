@@ -0,0 +1,207 @@
+#include "game.hpp"
+
+// one tick of k / BaseTickRate seconds, the rates are scaled by k; grip
+// blends the drag and thrust of the grass (0) and the road (1)
+void UpdateCar(const CarInputs &inputs, CarData &car, float k, float grip) {
+  const auto accum = [](float t, float m) -> float { return t / m; };
+  const float coef_cs = 0.01f;
+  const float coef_ds = Lerp(powf(GrassDrag, k), powf(0.98f, k), grip);
+  const float dt = 0.5f * k;
+  // const float vl = 2.0f * (1.0f - expf(-Vector2Length(car.speed)));
+  const float vl = 2.0f * (1.0f - expf(-0.2f * Vector2Length(car.speed)));
+  const float cs = coef_cs * vl;
+  const float dx = cos(car.dir);
+  const float dy = sin(car.dir);
+  const float acc =
+      0.4f * accum(car.thrust, 100.0f) * Lerp(GrassThrust, 1.0f, grip) * k;
+  const float dec =
+      0.2f * (1 - inputs.cthrust) * accum(inputs.brake, 1.0f) * k;
+  car.thrust = std::max(0.0f, car.thrust - 5.0f * inputs.brake * k);
+  car.thrust = car.thrust + inputs.cthrust * expf(-0.001f * car.thrust) * k;
+  car.thrust = std::max(0.0f, car.thrust - (1.0f - inputs.cthrust) * k);
+  car.slide = std::min(1.0f, (0.4f * inputs.brake + 0.1f * inputs.cthrust) *
+                                 (1.0f + abs(inputs.cwheel)));
+  car.dir += cs * (1 + 0.3f * inputs.brake) * inputs.cwheel * k;
+  car.speed = coef_ds * car.speed + (acc - dec) * Vector2{dx, dy};
+  const auto npos = car.pos + dt * GameScale * car.speed;
+  car.delta = npos - car.pos;
+  car.pos = npos;
+}
+
+bool CrossCheckPoint(const Checkpoint &cp, Vector2 lastPos, Vector2 newPos) {
+  const float dp0 = Vector2DotProduct(lastPos - cp.pos, cp.normal);
+  const float dp1 = Vector2DotProduct(newPos - cp.pos, cp.normal);
+  if (dp0 * dp1 >= 0)
+    return false;
+  const float r0 = Vector2DotProduct(lastPos - cp.pos, cp.axis);
+  const float r1 = Vector2DotProduct(newPos - cp.pos, cp.axis);
+  return abs(Lerp(r0, r1, dp0 / (dp0 - dp1))) < 1;
+}
+
+void UpdateCheckPoint(SimState &sim, Car &car, Vector2 lastPos,
+                      Vector2 newPos) {
+  const auto &track = *sim.track;
+  const auto &cps = track.checkpoints;
+  auto &player = sim.players[*car.playerIndex];
+  const int nextCP = (player.lastCP + 1) % cps.size();
+  if (CrossCheckPoint(cps[nextCP], lastPos, newPos)) {
+    TraceLog(LOG_INFO, "pass! %d", nextCP);
+    player.lastCP = nextCP;
+    if (nextCP == 0) {
+      if (player.startFrame) {
+        const int frames = sim.frame - *player.startFrame;
+        sim.bestChrono = std::min(frames, sim.bestChrono.value_or(frames));
+        player.bestChrono =
+            std::min(frames, player.bestChrono.value_or(frames));
+        player.laps += 1;
+      }
+      player.startFrame = sim.frame;
+    }
+    return;
+  }
+
+  const Rectangle move{
+      std::min(lastPos.x, newPos.x),
+      std::min(lastPos.y, newPos.y),
+      std::abs(newPos.x - lastPos.x),
+      std::abs(newPos.y - lastPos.y),
+  };
+  std::optional<int> crossed{};
+  QueryGrid(track.checkpointGrid, move, [&](int i) {
+    if (i != nextCP && CrossCheckPoint(cps[i], lastPos, newPos))
+      crossed = i;
+  });
+  if (crossed) {
+    TraceLog(LOG_INFO, "wrong checkpoint! %d", *crossed);
+    // reset pos
+  }
+}
+
+void SpawnParticles(SimState &sim, const Car &car, float k) {
+  const auto r = [&]() {
+    const int v = 18;
+    return Vector2{
+        float(sim.rng.Range(-v, v)),
+        float(sim.rng.Range(-v, v)),
+    };
+  };
+  const Vector2 d{
+      cosf(car.data.dir),
+      sinf(car.data.dir),
+  };
+  const Vector2 n{d.y, -d.x};
+  const float l = CarHalfLength;
+  const float w = CarHalfWidth;
+  const float str = car.data.slide;
+  const Vector2 speed = (45.0f / GameScale / k) * car.data.delta;
+  SpawnParticle(sim.particles, car.data.pos + l * d + w * n, r() + speed,
+                sim.gtime, str);
+  SpawnParticle(sim.particles, car.data.pos - l * d + w * n, r() + speed,
+                sim.gtime, str);
+  SpawnParticle(sim.particles, car.data.pos + l * d - w * n, r() + speed,
+                sim.gtime, str);
+  SpawnParticle(sim.particles, car.data.pos - l * d - w * n, r() + speed,
+                sim.gtime, str);
+}
+
+void SimStep(SimState &sim, std::span<const CarInputs> inputs) {
+  const float k = float(BaseTickRate) / sim.tickRate;
+  sim.gtime += 1.0 / sim.tickRate;
+
+  // one stage at a time, the next emplace closes the previous one
+  std::optional<ProfileScope> scope{};
+  scope.emplace(sim.profiler, Stage::Particles);
+  UpdateParticles(sim.particles, sim.gtime, 1.0f / sim.tickRate);
+
+  scope.emplace(sim.profiler, Stage::Physics);
+  const size_t count = sim.cars.size();
+  CarBatch &b = sim.batch;
+  ResizeCarBatch(b, count);
+  for (size_t i = 0; i < count; ++i) {
+    Car &car = sim.cars[i];
+    if (i < inputs.size())
+      car.inputs = inputs[i];
+    car.lastDir = car.data.dir;
+    b.posX[i] = car.data.pos.x;
+    b.posY[i] = car.data.pos.y;
+    b.speedX[i] = car.data.speed.x;
+    b.speedY[i] = car.data.speed.y;
+    b.thrust[i] = car.data.thrust;
+    b.dir[i] = car.data.dir;
+    b.cwheel[i] = car.inputs.cwheel;
+    b.cthrust[i] = car.inputs.cthrust;
+    b.brake[i] = car.inputs.brake;
+    b.grip[i] = SurfaceGrip(sim.track->surface, car.data.pos);
+  }
+
+  UpdateCars(b, count, k);
+
+  for (size_t i = 0; i < count; ++i) {
+    Car &car = sim.cars[i];
+    car.data = {
+        .pos = {b.posX[i], b.posY[i]},
+        .delta = {b.deltaX[i], b.deltaY[i]},
+        .speed = {b.speedX[i], b.speedY[i]},
+        .thrust = b.thrust[i],
+        .dir = b.dir[i],
+        .slide = b.slide[i],
+    };
+  }
+
+  scope.emplace(sim.profiler, Stage::Collisions);
+  CollideCars(sim);
+  for (Car &car : sim.cars)
+    car.trackPos = ProjectOnTrack(sim.track->space, car.data.pos, car.trackPos);
+
+  scope.emplace(sim.profiler, Stage::Checkpoints);
+  for (Car &car : sim.cars) {
+    if (car.playerIndex)
+      UpdateCheckPoint(sim, car, car.data.pos - car.data.delta, car.data.pos);
+  }
+
+  // BaseTickRate spawns per second whatever the tick rate
+  scope.emplace(sim.profiler, Stage::Particles);
+  const int spawnPhase =
+      int(int64_t(sim.frame) * BaseTickRate % sim.tickRate);
+  for (const Car &car : sim.cars) {
+    if (car.data.slide > 0.0f && spawnPhase < BaseTickRate)
+      SpawnParticles(sim, car, k);
+  }
+  scope.reset();
+
+  sim.frame += 1;
+}
+
+// the cars are copied into the snapshot's own storage, which only allocates
+// the first time
+void SaveSnapshot(const SimState &sim, SimSnapshot &snap) {
+  snap.core = sim;
+  snap.cars.assign(sim.cars.begin(), sim.cars.end());
+}
+
+void RestoreSnapshot(SimState &sim, const SimSnapshot &snap) {
+  static_cast<SimCore &>(sim) = snap.core;
+  sim.cars.assign(snap.cars.begin(), snap.cars.end());
+}
+
+// FNV-1a over the state the race outcome depends on, to compare peers
+uint32_t SimChecksum(const SimState &sim) {
+  uint32_t h = 2166136261u;
+  const auto mix = [&](const auto &v) {
+    const uint8_t *p = (const uint8_t *)&v;
+    for (size_t i = 0; i < sizeof(v); ++i)
+      h = (h ^ p[i]) * 16777619u;
+  };
+  mix(sim.frame);
+  for (const Player &p : sim.players) {
+    mix(p.lastCP);
+    mix(p.laps);
+  }
+  for (const Car &car : sim.cars) {
+    mix(car.data.pos);
+    mix(car.data.speed);
+    mix(car.data.thrust);
+    mix(car.data.dir);
+  }
+  return h;
+}
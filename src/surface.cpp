@@ -0,0 +1,83 @@
+#include "game.hpp"
+
+// The grid stores, at each node, the signed distance to the road edge in
+// SurfaceUnit steps, negative on the road. Nodes further than the int8 range
+// are clamped, which only matters away from the edge where grip is constant.
+// It is baked from chords of BakeStride track space steps, finer than the
+// rows of the road mesh, each one only visiting the nodes of the band it can
+// be nearest to.
+
+namespace {
+
+constexpr float SurfaceUnit = 1.0f / 16.0f;
+constexpr float SurfaceCell = 2.0f;
+constexpr int BakeStride = 4;
+// width of the blend between road and grass grip around the edge
+constexpr float Shoulder = 2.0f;
+
+} // namespace
+
+SurfaceGrid MakeSurfaceGrid(const TrackSpace &ts, float halfWidth,
+                            Rectangle bounds) {
+  SurfaceGrid grid{
+      .bounds = bounds,
+      .cellSize = SurfaceCell,
+      .cols = int(ceilf(bounds.width / SurfaceCell)) + 1,
+      .rows = int(ceilf(bounds.height / SurfaceCell)) + 1,
+  };
+  grid.dist.assign(size_t(grid.cols) * grid.rows, INT8_MAX);
+
+  const float reach = halfWidth + INT8_MAX * SurfaceUnit;
+  const float inner = std::max(0.0f, halfWidth - INT8_MAX * SurfaceUnit);
+  const int count = ts.pos.size();
+  for (int i = 0; i < count; i += BakeStride) {
+    const Vector2 a = ts.pos[i];
+    const Vector2 ab = ts.pos[std::min(i + BakeStride, count) % count] - a;
+    const float invLsq = 1.0f / std::max(Vector2LengthSqr(ab), 1e-6f);
+    const auto node = [&](float v, float o, int n) {
+      return std::clamp(int((v - o) / SurfaceCell), 0, n - 1);
+    };
+    const int x0 = node(std::min(a.x, a.x + ab.x) - reach, bounds.x, grid.cols);
+    const int y0 = node(std::min(a.y, a.y + ab.y) - reach, bounds.y, grid.rows);
+    const int x1 = node(std::max(a.x, a.x + ab.x) + reach, bounds.x, grid.cols);
+    const int y1 = node(std::max(a.y, a.y + ab.y) + reach, bounds.y, grid.rows);
+    for (int y = y0; y <= y1; ++y) {
+      for (int x = x0; x <= x1; ++x) {
+        const Vector2 p{bounds.x + x * SurfaceCell, bounds.y + y * SurfaceCell};
+        const float t =
+            Clamp(Vector2DotProduct(p - a, ab) * invLsq, 0.0f, 1.0f);
+        const float dsq = Vector2DistanceSqr(p, a + t * ab);
+        if (dsq >= reach * reach)
+          continue;
+        int q = -INT8_MAX;
+        if (dsq > inner * inner) {
+          const float d = sqrtf(dsq) - halfWidth;
+          q = std::clamp(int(roundf(d / SurfaceUnit)), -INT8_MAX,
+                         int(INT8_MAX));
+        }
+        int8_t &cell = grid.dist[size_t(y) * grid.cols + x];
+        cell = std::min(cell, int8_t(q));
+      }
+    }
+  }
+  return grid;
+}
+
+// 1 on the road, 0 on the grass, bilinear between the 4 nodes around p
+float SurfaceGrip(const SurfaceGrid &grid, Vector2 p) {
+  if (grid.dist.empty())
+    return 1.0f;
+  const float u = Clamp((p.x - grid.bounds.x) / grid.cellSize, 0.0f,
+                        float(grid.cols - 1));
+  const float v = Clamp((p.y - grid.bounds.y) / grid.cellSize, 0.0f,
+                        float(grid.rows - 1));
+  const int x = std::min(int(u), grid.cols - 2);
+  const int y = std::min(int(v), grid.rows - 2);
+  const float fx = u - x;
+  const float fy = v - y;
+  const int8_t *row = &grid.dist[size_t(y) * grid.cols + x];
+  const float d0 = Lerp(row[0], row[1], fx);
+  const float d1 = Lerp(row[grid.cols], row[grid.cols + 1], fx);
+  const float d = Lerp(d0, d1, fy) * SurfaceUnit;
+  return Clamp(0.5f - d / Shoulder, 0.0f, 1.0f);
+}
@@ -0,0 +1,102 @@
+#include "game.hpp"
+
+TrackSpace MakeTrackSpace(const std::vector<Vector2> &points, float step) {
+  const int dense = 64 * points.size();
+  std::vector<float> lengths(dense + 1);
+  Vector2 last = GetSplineAndDir(points, 0.0f).first;
+  for (int i = 1; i <= dense; ++i) {
+    const Vector2 p = GetSplineAndDir(points, i / float(dense)).first;
+    lengths[i] = lengths[i - 1] + Vector2Distance(last, p);
+    last = p;
+  }
+
+  TrackSpace ts;
+  ts.length = lengths.back();
+  const int count = std::max(3, int(ts.length / step + 0.5f));
+  ts.step = ts.length / count;
+  int j = 0;
+  for (int i = 0; i < count; ++i) {
+    const float s = i * ts.step;
+    while (lengths[j + 1] < s)
+      ++j;
+    const float t = (s - lengths[j]) / (lengths[j + 1] - lengths[j]);
+    const auto [p, n] = GetSplineAndDir(points, (j + t) / dense);
+    ts.pos.push_back(p);
+    ts.normal.push_back(n);
+  }
+  return ts;
+}
+
+std::pair<Vector2, Vector2> SampleTrack(const TrackSpace &ts, float s) {
+  const float u = Wrap(s, 0.0f, ts.length) / ts.step;
+  const int i0 = std::min(int(u), int(ts.pos.size()) - 1);
+  const int i1 = (i0 + 1) % ts.pos.size();
+  const float t = u - i0;
+  return {
+      Vector2Lerp(ts.pos[i0], ts.pos[i1], t),
+      Vector2Normalize(Vector2Lerp(ts.normal[i0], ts.normal[i1], t)),
+  };
+}
+
+namespace {
+
+struct SegmentHit {
+  float t{};
+  float dsq{};
+};
+
+SegmentHit HitSegment(const TrackSpace &ts, int i, Vector2 p) {
+  const Vector2 a = ts.pos[i];
+  const Vector2 ab = ts.pos[(i + 1) % ts.pos.size()] - a;
+  const float t = Clamp(Vector2DotProduct(p - a, ab) / Vector2LengthSqr(ab),
+                        0.0f, 1.0f);
+  return {t, Vector2DistanceSqr(p, a + t * ab)};
+}
+
+TrackPos MakeTrackPos(const TrackSpace &ts, int i, Vector2 p,
+                      const SegmentHit &hit) {
+  const int i1 = (i + 1) % ts.pos.size();
+  const Vector2 q = Vector2Lerp(ts.pos[i], ts.pos[i1], hit.t);
+  const Vector2 n = Vector2Lerp(ts.normal[i], ts.normal[i1], hit.t);
+  return {
+      .s = (i + hit.t) * ts.step,
+      .lateral = Vector2DotProduct(p - q, Vector2Normalize(n)),
+      .segment = i,
+  };
+}
+
+} // namespace
+
+TrackPos ProjectOnTrack(const TrackSpace &ts, Vector2 p) {
+  int best = 0;
+  SegmentHit bestHit = HitSegment(ts, 0, p);
+  for (int i = 1; i < int(ts.pos.size()); ++i) {
+    const SegmentHit hit = HitSegment(ts, i, p);
+    if (hit.dsq < bestHit.dsq) {
+      best = i;
+      bestHit = hit;
+    }
+  }
+  return MakeTrackPos(ts, best, p, bestHit);
+}
+
+// walk from the hint segment while the distance decreases, which stays O(1)
+// as long as p moved by a few steps since the hint was computed
+TrackPos ProjectOnTrack(const TrackSpace &ts, Vector2 p, const TrackPos &hint) {
+  const int count = ts.pos.size();
+  int best = hint.segment;
+  SegmentHit bestHit = HitSegment(ts, best, p);
+  for (const int dir : {1, count - 1}) {
+    for (int i = (best + dir) % count; i != hint.segment;
+         i = (i + dir) % count) {
+      const SegmentHit hit = HitSegment(ts, i, p);
+      if (hit.dsq >= bestHit.dsq)
+        break;
+      best = i;
+      bestHit = hit;
+    }
+    if (best != hint.segment)
+      break;
+  }
+  return MakeTrackPos(ts, best, p, bestHit);
+}
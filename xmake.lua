@@ -1,10 +1,40 @@
-
 add_rules("mode.debug", "mode.release")
 
+option("avx2")
+    set_default(false)
+    set_showmenu(true)
+    set_description("Build the batched car physics with AVX2")
+
 target("main")
     set_kind("binary")
     add_files("src/*.cpp")
     add_cxflags("-std=c++20")
+    -- no fused multiply-adds, so that every build simulates the same
+    add_cxflags("-ffp-contract=off", {tools = {"gcc", "clang"}})
     add_links("raylib")
+    if is_plat("linux") then
+        add_syslinks("pthread")
+    end
+    if has_config("avx2") then
+        add_vectorexts("avx2")
+    end
+    if is_mode("debug") then
+        add_defines("DEBUG")
+    end
     set_rundir(".")
 
+target("bench")
+    set_kind("binary")
+    set_default(false)
+    add_files("src/*.cpp|main.cpp", "bench/*.cpp")
+    add_includedirs("src")
+    add_cxflags("-std=c++20")
+    add_cxflags("-ffp-contract=off", {tools = {"gcc", "clang"}})
+    add_links("raylib")
+    if is_plat("linux") then
+        add_syslinks("pthread")
+    end
+    if has_config("avx2") then
+        add_vectorexts("avx2")
+    end
+    set_rundir(".")